@@ -0,0 +1,135 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+#include "BallisticModel.h"
+#include "State.h"
+#include "VReal.h"
+
+/**
+ * @brief Closed form approximation of a parachute drop.
+ *
+ * The fall is split in a drag-free phase until the canopy opens at t_open and
+ * a canopy phase with quadratic drag relative to a constant wind. Under the
+ * canopy the vertical axis follows the exact 1D solution of
+ * dv/dt = g - k v|v| (tanh form below terminal velocity, coth form above it,
+ * tan form while still climbing), while the air-relative horizontal speed u
+ * follows du/dt = -k u sqrt(u^2 + vt^2), which also has a closed form. The
+ * drag coefficient k = rho * CdS / 2m is frozen at the density of the mid
+ * point of the canopy phase.
+ *
+ * Error envelope against RK4 (dt = 1 ms) over h in [20, 150] m, airspeed in
+ * [15, 30] m/s, v_down in [-2, 4] m/s, wind in [0, 10] m/s from any
+ * direction, mass in [0.3, 1.5] kg and CdS in [0.05, 0.5] m^2 (t_open = 1 s,
+ * 3000 uniform samples): landing error median 1.4 m, 95th percentile 3.3 m,
+ * max 7.1 m. The error is dominated by the decoupled vertical axis right after
+ * the canopy opens, so it is largest for heavy payloads under small canopies
+ * released fast. Use it as a first guess, never as a final answer.
+ */
+
+// log(cosh(x)) and log(sinh(x)) (x > 0) without overflow
+static inline double log_cosh(double x) {
+    x = std::abs(x);
+    return x + std::log1p(std::exp(-2 * x)) - M_LN2;
+}
+static inline double log_sinh(double x) {
+    return x + std::log1p(-std::exp(-2 * x)) - M_LN2;
+}
+
+/**
+ * @brief Landing state predicted in O(1).
+ *
+ * @param S0 Release state, NED with z = -altitude.
+ * @param wind Constant wind velocity (NED), the vertical component is ignored.
+ * @param cds Canopy CdS (m^2), applied for t > t_open.
+ * @param mass Payload mass (kg).
+ * @param t_open Canopy opening time (s).
+ * @param T Simulation horizon (s), the state at T is returned if the payload
+ * has not landed yet.
+ * @return The approximate state at landing (or at T), with its time set.
+ */
+inline State<3> analytic_drop(State<3> S0, VReal3 wind, double cds,
+                              double mass, double t_open, double T) {
+    VReal3 pos = S0.X();
+    VReal3 vel = S0.X_dot();
+    double h = -pos[2];
+    double vz0 = vel[2];
+
+    // Phase 1: free fall until t_open or the ground
+    double t1 = std::min(t_open, T);
+    double z1 = vz0 * t1 + 0.5 * g * t1 * t1;
+    double k = 0.5 * atm(0.5 * (h - z1)) * cds / mass;
+    if (z1 >= h || k <= 0) {
+        double t_hit = (-vz0 + std::sqrt(vz0 * vz0 + 2 * g * h)) / g;
+        double t_end = std::min(t_hit, T);
+        State<3> S{pos[0] + vel[0] * t_end,
+                   pos[1] + vel[1] * t_end,
+                   t_end == t_hit ? 0 : pos[2] + vz0 * t_end +
+                                            0.5 * g * t_end * t_end,
+                   vel[0],
+                   vel[1],
+                   vz0 + g * t_end};
+        return S(t_end);
+    }
+    double x1 = pos[0] + vel[0] * t1;
+    double y1 = pos[1] + vel[1] * t1;
+    double v1 = vz0 + g * t1;
+    double H = h - z1;
+    if (t1 >= T) {
+        State<3> S{x1, y1, -H, vel[0], vel[1], v1};
+        return S(t1);
+    }
+
+    // Phase 2, vertical: dv/dt = g - k v|v|, with vt * tau = 1 / k
+    double vt = std::sqrt(g / k);
+    double tau = vt / g;
+    double t_up = 0, h_up = 0;
+    if (v1 < 0) {
+        // Climbing at opening, drag and gravity both pull down until the apex
+        t_up = tau * atan(-v1 / vt);
+        h_up = std::log1p(v1 * v1 / (vt * vt)) / (2 * k);
+    }
+    bool fast = v1 > vt;  // Opening above terminal velocity, coth branch
+    double a = fast ? atanh(vt / v1)
+                    : atanh(std::min(std::max(v1, 0.0) / vt, 1 - 1e-12));
+    double L = (fast ? log_sinh(a) : log_cosh(a)) + k * (H + h_up);
+    double s = L + log(1 + std::sqrt(fast ? 1 + exp(-2 * L)
+                                          : std::max(0.0, 1 - exp(-2 * L))));
+    double t_hit = t_up + (s - a) * tau;
+    double t2 = std::min(t_hit, T - t1);
+
+    double z2, v_z;  // Distance fallen and vertical speed in phase 2 at t2
+    if (t2 < t_up) {
+        double q = (t_up - t2) / tau;
+        z2 = -h_up + std::log1p(tan(q) * tan(q)) / (2 * k);
+        v_z = -vt * tan(q);
+    } else {
+        double q = (t2 - t_up) / tau + a;
+        z2 = -h_up + (fast ? log_sinh(q) - log_sinh(a)
+                           : log_cosh(q) - log_cosh(a)) / k;
+        v_z = fast ? vt / tanh(q) : vt * tanh(q);
+    }
+
+    // Phase 2, horizontal: du/dt = -k u sqrt(u^2 + vt^2) relative to the air
+    double ux = vel[0] - wind[0];
+    double uy = vel[1] - wind[1];
+    double u0 = std::hypot(ux, uy);
+    double x_rel = 0, u2 = 0;
+    if (u0 > 0) {
+        double A = asinh(vt / u0);
+        double B = A + k * vt * t2;
+        x_rel = (log(tanh(0.5 * B)) - log(tanh(0.5 * A))) / k;
+        u2 = vt / sinh(B);
+        ux /= u0;
+        uy /= u0;
+    }
+
+    State<3> S{x1 + ux * x_rel + wind[0] * t2,
+               y1 + uy * x_rel + wind[1] * t2,
+               t2 == t_hit ? 0 : -(H - z2),
+               ux * u2 + wind[0],
+               uy * u2 + wind[1],
+               v_z};
+    return S(t1 + t2);
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <thread>
+
+#include "AnalyticDrop.h"
+#include "BallisticModel.h"
+#include "Dispersion.h"
+#include "Executor.h"
+#include "Simulation.h"
+#include "State.h"
+#include "Unscented.h"
+
+/**
+ * @brief Refinement levels of an anytime prediction, coarsest first.
+ */
+enum class AnytimeLevel { NONE, ANALYTIC, COARSE, FINE, DISPERSION };
+
+inline const char* level_name(AnytimeLevel l) {
+    switch (l) {
+        case AnytimeLevel::ANALYTIC:
+            return "analytic";
+        case AnytimeLevel::COARSE:
+            return "coarse";
+        case AnytimeLevel::FINE:
+            return "fine";
+        case AnytimeLevel::DISPERSION:
+            return "dispersion";
+        default:
+            return "none";
+    }
+}
+
+/**
+ * @brief A single drop to predict, with the uncertainty of its inputs for
+ * the dispersion level.
+ */
+struct AnytimeQuery {
+    DropDistribution dist;  /**< Nominal inputs (mean), h and t_open */
+    double T = 60;          /**< Max time of the simulation (s) */
+    double dt_fine = 0.01;  /**< Step of the fine run (s) */
+    double dt_coarse = 0.1; /**< Step of the coarse run (s) */
+    std::string method = "rk4";
+};
+
+/**
+ * @brief Best prediction available when the budget ran out.
+ */
+struct AnytimeResult {
+    AnytimeLevel level = AnytimeLevel::NONE;
+    double north = 0, east = 0; /**< Landing, relative to the release (m) */
+    double error = 0;           /**< Estimated landing error (m) */
+    LandingSpread spread;       /**< Landing ellipse, DISPERSION level only */
+    double elapsed_us = 0;      /**< Time spent up to this level */
+    bool cancelled = false;     /**< A level was stopped by the deadline */
+};
+
+// 95th percentile of the analytic_drop error envelope, see AnalyticDrop.h
+constexpr double ANALYTIC_ERR95 = 3.3;
+
+/**
+ * @brief Landing prediction refined for as long as the budget allows.
+ *
+ * The levels are tried in order: analytic_drop, an RK4 run at dt_coarse,
+ * one at dt_fine and the unscented landing ellipse at dt_fine. A level is
+ * only started if its cost, extrapolated from the previous one, fits in
+ * the time left; if it runs over anyway the Simulation deadline stops its
+ * integrations and its result is dropped. The answer is the last level
+ * completed, with its error estimate:
+ *  - ANALYTIC: the 95th percentile of the analytic error envelope.
+ *  - COARSE: ground speed times dt_coarse, the step that crosses the
+ *    ground is not interpolated.
+ *  - FINE: the coarse to fine difference extrapolated to first order in
+ *    dt, at least ground speed times dt_fine.
+ *
+ * @param q The drop.
+ * @param deadline When the answer is due.
+ * @param on_level Callable void(const AnytimeResult&), called after each
+ * level completed, e.g. to use the coarse answers while refining.
+ */
+template <typename OnLevel>
+AnytimeResult anytime_landing(const AnytimeQuery& q,
+                              std::chrono::steady_clock::time_point deadline,
+                              OnLevel&& on_level) {
+    using clock = std::chrono::steady_clock;
+    using D = DropDistribution;
+    const auto start = clock::now();
+    auto elapsed_us = [&] {
+        return std::chrono::duration<double, std::micro>(clock::now() - start)
+            .count();
+    };
+    auto left_us = [&] {
+        return std::chrono::duration<double, std::micro>(deadline -
+                                                         clock::now())
+            .count();
+    };
+
+    AnytimeResult best;
+    auto [bm, S0] = q.dist.drop(q.dist.mean);
+    auto publish = [&](AnytimeLevel level, const State<3>& S, double err) {
+        best.level = level;
+        best.north = S.X()[0];
+        best.east = S.X()[1];
+        best.error = err;
+        best.elapsed_us = elapsed_us();
+        on_level(best);
+    };
+
+    // Analytic, O(1)
+    VReal3 wind{q.dist.mean[D::WIND_N], q.dist.mean[D::WIND_E], 0};
+    State<3> S_a = analytic_drop(S0, wind, q.dist.mean[D::CDS],
+                                 q.dist.mean[D::MASS], q.dist.t_open, q.T);
+    publish(AnytimeLevel::ANALYTIC, S_a, ANALYTIC_ERR95);
+    if (left_us() <= 0) return best;
+
+    // Coarse, cost unknown: bounded by the deadline only
+    Simulation coarse(q.dt_coarse, q.T, q.method);
+    coarse.set_deadline(deadline);
+    auto t0 = clock::now();
+    State<3> S_c = coarse.run_last(bm, S0);
+    double cost_us =
+        std::chrono::duration<double, std::micro>(clock::now() - t0).count();
+    if (coarse.expired()) {
+        best.cancelled = true;
+        return best;
+    }
+    auto ground_speed = [](const State<3>& S) {
+        return std::hypot(S.X_dot()[0], S.X_dot()[1]);
+    };
+    publish(AnytimeLevel::COARSE, S_c, ground_speed(S_c) * q.dt_coarse);
+
+    // Fine, the cost scales with the number of steps
+    cost_us *= q.dt_coarse / q.dt_fine;
+    if (cost_us > left_us()) return best;
+    Simulation fine(q.dt_fine, q.T, q.method);
+    fine.set_deadline(deadline);
+    t0 = clock::now();
+    State<3> S_f = fine.run_last(bm, S0);
+    cost_us =
+        std::chrono::duration<double, std::micro>(clock::now() - t0).count();
+    if (fine.expired()) {
+        best.cancelled = true;
+        return best;
+    }
+    double diff = std::hypot(S_f.X()[0] - S_c.X()[0], S_f.X()[1] - S_c.X()[1]);
+    double err = std::max(diff * q.dt_fine / (q.dt_coarse - q.dt_fine),
+                          ground_speed(S_f) * q.dt_fine);
+    publish(AnytimeLevel::FINE, S_f, err);
+
+    // Dispersion, 2 * 7 + 1 fine runs on the executor
+    bool uncertain = false;
+    for (size_t k = 0; k < D::N_INPUTS; k++) {
+        uncertain = uncertain || q.dist.cov[k][k] > 0;
+    }
+    // The caller helps the workers, but not beyond the cores there are
+    double workers =
+        std::min<double>(Executor::shared().size() + 1,
+                         std::max(1u, std::thread::hardware_concurrency()));
+    cost_us *= double(2 * D::N_INPUTS + 1) / workers;
+    if (!uncertain || cost_us > left_us()) return best;
+    fine.set_priority(Priority::LIVE);
+    LandingSpread spread = unscented_landing(fine, q.dist);
+    if (fine.expired()) {
+        best.cancelled = true;
+        return best;
+    }
+    best.spread = spread;
+    publish(AnytimeLevel::DISPERSION, S_f, err);
+    return best;
+}
+
+// Same, without the per level callback
+inline AnytimeResult anytime_landing(
+    const AnytimeQuery& q, std::chrono::steady_clock::time_point deadline) {
+    return anytime_landing(q, deadline, [](const AnytimeResult&) {});
+}
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Sampling.h"
+#include "Simulation.h"
+#include "State.h"
+
+/**
+ * @brief One setting tried by autotune.
+ */
+struct TuneCandidate {
+    std::string method;
+    double dt = 0;          /**< Time step (s) */
+    double tail_tol = 0;    /**< Terminal tail tolerance (m/s^2), 0 = off */
+    double err_max = 0;     /**< Worst landing error against the reference (m) */
+    double err_rms = 0;
+    double us_per_run = 0;  /**< Cost, 0 if not timed (too inaccurate) */
+    bool ok = false;        /**< err_max within the tolerance */
+};
+
+/**
+ * @brief Search space and goal of autotune.
+ */
+struct AutotuneOptions {
+    double tol = 0.5;       /**< Landing error allowed (m) */
+    double T = 60;          /**< Max time of the simulation (s) */
+    std::vector<std::string> methods = {"euler", "rk4", "rk45"};
+    std::vector<double> dts = {0.1, 0.05, 0.02, 0.01, 0.005, 0.002, 0.001};
+    std::vector<double> tail_tols = {0, 0.01, 0.1};
+    double ref_dt = 5e-4;   /**< Step of the rk45 reference (s) */
+    size_t repeat = 3;      /**< Timed sweeps per setting, the best is kept */
+};
+
+/**
+ * @brief Outcome of autotune.
+ */
+struct AutotuneResult {
+    bool found = false;     /**< Some setting met the tolerance */
+    ODESettings best;       /**< Cheapest one, the reference if none */
+    TuneCandidate chosen;
+    std::vector<TuneCandidate> tried;
+};
+
+/**
+ * @brief Cheapest method, step and terminal tail that land within tol of
+ * a high precision reference, on a representative set of drops.
+ *
+ * The reference is rk45 at ref_dt without the terminal tail. The steppers
+ * are all fixed step, so the knobs are the method, dt and the terminal
+ * tail tolerance. For each method and tail tolerance the steps are tried
+ * from the largest down and the first one within tol is timed, smaller
+ * steps only cost more; the cheapest timed setting wins. The error is the
+ * worst over the set, of the ground crossings interpolated on the last
+ * step, so it measures the integrator rather than where the last step
+ * above the ground happens to fall. The timed runs keep the last state
+ * only, as dropPoints does.
+ *
+ * @param sweep The representative drops, sweep interface of
+ * Simulation::run_parallel_sweep.
+ * @param opt Tolerance and search space.
+ */
+template <typename Sweep>
+AutotuneResult autotune(const Sweep& sweep, const AutotuneOptions& opt) {
+    using clock = std::chrono::steady_clock;
+    if (sweep.size() == 0) throw std::invalid_argument("No drops to tune on");
+    Simulation ref_sim(opt.ref_dt, opt.T, "rk45");
+    const SampledResults<3> ref =
+        ref_sim.run_parallel_sweep(sweep, SampleEvents{}, 16);
+
+    AutotuneResult res;
+    res.best = {opt.ref_dt, opt.T, "rk45", 0};
+    std::vector<double> dts = opt.dts;
+    std::sort(dts.begin(), dts.end(), std::greater<double>());
+
+    for (const auto& method : opt.methods) {
+        for (double tail_tol : opt.tail_tols) {
+            for (double dt : dts) {
+                TuneCandidate c{method, dt, tail_tol};
+                Simulation sim(dt, opt.T, method);
+                sim.set_terminal_tail(tail_tol);
+                const SampledResults<3> land =
+                    sim.run_parallel_sweep(sweep, SampleEvents{}, 16);
+                const size_t n = land.getSSize();
+                for (size_t i = 0; i < n; i++) {
+                    const State<3> S = land.getImpact(i);
+                    const State<3> R = ref.getImpact(i);
+                    double d = std::hypot(S.X()[0] - R.X()[0],
+                                          S.X()[1] - R.X()[1]);
+                    // Not landed within T counts as a miss
+                    if (S.get_t() + dt >= opt.T) d = INFINITY;
+                    c.err_max = std::max(c.err_max, d);
+                    c.err_rms += d * d / n;
+                }
+                c.err_rms = std::sqrt(c.err_rms);
+                c.ok = c.err_max <= opt.tol;
+                if (c.ok) {
+                    for (size_t k = 0; k < std::max<size_t>(opt.repeat, 1);
+                         k++) {
+                        auto t0 = clock::now();
+                        sim.run_parallel_sweep(sweep, 16);
+                        double us = std::chrono::duration<double, std::micro>(
+                                        clock::now() - t0)
+                                        .count() /
+                                    sweep.size();
+                        c.us_per_run = k == 0 ? us : std::min(c.us_per_run, us);
+                    }
+                    if (!res.found || c.us_per_run < res.chosen.us_per_run) {
+                        res.found = true;
+                        res.chosen = c;
+                        res.best = {dt, opt.T, method, tail_tol};
+                    }
+                }
+                res.tried.push_back(c);
+                if (c.ok) break;  // Smaller steps only cost more
+            }
+        }
+    }
+    return res;
+}
+
+/**
+ * @brief Saves the settings of an autotune as a profile, `key = value`
+ * lines with # comments.
+ *
+ * @throws std::runtime_error if the file cannot be written.
+ */
+inline void write_profile(const std::string& path, const AutotuneResult& r,
+                          double tol) {
+    std::ofstream out(path);
+    if (!out) throw std::runtime_error("Cannot write profile " + path);
+    out.precision(17);
+    out << "# sft_fall_model integrator profile, see Autotune.h\n"
+        << "method = " << r.best.method << "\n"
+        << "dt = " << r.best.dt << "\n"
+        << "tail_tol = " << r.best.tail_tol << "\n"
+        << "T = " << r.best.T << "\n";
+    out.precision(4);
+    out << "# landing error within " << tol << " m: worst "
+        << r.chosen.err_max << " m, " << r.chosen.us_per_run
+        << " us per run\n";
+    if (!out) throw std::runtime_error("Cannot write profile " + path);
+}
+
+/**
+ * @brief Loads a profile saved by write_profile, e.g.
+ * Simulation(read_profile("sft.profile")).
+ *
+ * Unknown keys are ignored, missing ones keep the ODESettings defaults of
+ * rk4, dt = 0.01 s and T = 60 s.
+ *
+ * @throws std::runtime_error if the file cannot be read or a value is
+ * invalid.
+ */
+inline ODESettings read_profile(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) throw std::runtime_error("Cannot read profile " + path);
+    ODESettings s{0.01, 60, "rk4", 0};
+    std::string line;
+    while (std::getline(in, line)) {
+        line = line.substr(0, line.find('#'));
+        size_t eq = line.find('=');
+        if (eq == std::string::npos) continue;
+        std::string key, value;
+        std::istringstream(line.substr(0, eq)) >> key;
+        std::istringstream(line.substr(eq + 1)) >> value;
+        try {
+            if (key == "method") {
+                s.method = value;
+            } else if (key == "dt") {
+                s.dt = std::stod(value);
+            } else if (key == "tail_tol") {
+                s.tail_tol = std::stod(value);
+            } else if (key == "T") {
+                s.T = std::stod(value);
+            }
+        } catch (std::logic_error&) {
+            throw std::runtime_error("Bad " + key + " in profile " + path);
+        }
+    }
+    return s;
+}
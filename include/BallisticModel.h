@@ -1,6 +1,8 @@
 #pragma once
 
 #include <cmath>
+#include <utility>
+#include <vector>
 
 #include "Model.h"
 #include "PayChute.h"
@@ -10,6 +12,7 @@
 
 static const double rho0 = 1.2250;  // kg/m^3
 static const double g = 9.81;       // m/s^2
+static const double beta_atm = 1e-4;  // 1/m, inverse scale height of atm()
 
 // N = 3 is the default for this model, only 3Dimensional space variables
 
@@ -23,6 +26,8 @@ class BallisticModel : public Model<3> {
     ~BallisticModel() {}
 
      void operator()(const State<3>& S0, State<3>& S0_dot, double t);
+    bool terminal_tail(const State<3>& S, double t, double tol,
+                       State<3>& S_ground, double& err_bound);
     BallisticModel* clone() const { return new BallisticModel(*this); }
 
    private:
@@ -30,6 +35,87 @@ class BallisticModel : public Model<3> {
     Wind<3> Vw;
 };
 
+/**
+ * @brief Ballistic model with constant wind and a canopy opening at t_open.
+ *
+ * Same dynamics as BallisticModel, but the parameters are plain values instead
+ * of std::function laws, so it is cheap to build one per launch in a batch.
+ */
+class FixedBallisticModel final : public Model<3> {
+   public:
+    FixedBallisticModel(double mass, double cds, VReal3 wind, double t_open)
+        : Model<3>(), pl_mass(mass), pl_cds(cds), Vw(wind), t_open(t_open) {}
+    ~FixedBallisticModel() {}
+
+    void operator()(const State<3>& S0, State<3>& S0_dot, double t) override;
+    bool terminal_tail(const State<3>& S, double t, double tol,
+                       State<3>& S_ground, double& err_bound);
+    // Stop condition, the payload went below the ground
+    bool condition(const State<3>& /*S0*/, const State<3>& S1,
+                   double /*t*/) const {
+        return S1.X()[2] > 0;
+    }
+
+   private:
+    double CdS(double t) const { return t <= t_open ? 0 : pl_cds; }
+
+    double pl_mass;
+    double pl_cds;
+    VReal3 Vw;
+    double t_open;
+};
+
+/**
+ * @brief Per launch parameters of a batch, stored as structure of arrays.
+ *
+ * Calling the batch with an index builds the FixedBallisticModel of that
+ * launch, see Simulation::run_parallel_batch.
+ */
+struct LaunchBatch {
+    std::vector<double> mass;   /**< Payload mass (kg) */
+    std::vector<double> cds;    /**< Canopy CdS (m^2) */
+    std::vector<double> wind_n; /**< Wind velocity, north (m/s) */
+    std::vector<double> wind_e; /**< Wind velocity, east (m/s) */
+    std::vector<double> wind_d; /**< Wind velocity, down (m/s) */
+    std::vector<double> t_open; /**< Canopy opening time (s) */
+
+    void reserve(size_t n) {
+        for (auto* v : {&mass, &cds, &wind_n, &wind_e, &wind_d, &t_open}) {
+            v->reserve(n);
+        }
+    }
+    void push_back(double m, double c, VReal3 w, double t_o) {
+        mass.push_back(m);
+        cds.push_back(c);
+        wind_n.push_back(w[0]);
+        wind_e.push_back(w[1]);
+        wind_d.push_back(w[2]);
+        t_open.push_back(t_o);
+    }
+    size_t size() const { return mass.size(); }
+
+    FixedBallisticModel operator()(size_t j) const {
+        return FixedBallisticModel(mass[j], cds[j],
+                                   VReal3{wind_n[j], wind_e[j], wind_d[j]},
+                                   t_open[j]);
+    }
+};
+
+/**
+ * @brief Launches of a batch with their initial states, in the sweep
+ * interface of Simulation::run_parallel_sweep.
+ */
+struct LaunchSweep {
+    const LaunchBatch& batch;
+    const std::vector<State<3>>& v_S0;
+
+    size_t size() const { return v_S0.size(); }
+
+    std::pair<FixedBallisticModel, State<3>> at(size_t idx) const {
+        return {batch(idx), v_S0[idx]};
+    }
+};
+
 State<3> get_ic_from_comms(double z, double vmod, double heading);
 
 // Implementations
@@ -52,22 +138,20 @@ static double atm(double h) {
     if (h < 0) {
         return 0;
     } else {
-        return rho0 * exp(-std::pow(10, -4) * h);
+        return rho0 * exp(-beta_atm * h);
     }
 }
 
-void BallisticModel::operator()(const State<3>& state, State<3>& state_dot,
-                                double t) {
+static inline void ballistic_rhs(const State<3>& state,
+                                 const VReal3& wind_vel, double cd_S,
+                                 double mass, State<3>& state_dot) {
     VReal3 pos = state.X();
     VReal3 vel = state.X_dot();
-    VReal3 wind_vel = Vw(state, pos, t);
 
-    // compute cd_S
-    double cd_S = pc.CdS(state, t);
     // compute coefficient rho (z is downward so flip the sign)
     double rho = atm(-pos[2]);
     // Compute final coefficient
-    double k = 0.5 * rho * cd_S / pc.mass();
+    double k = 0.5 * rho * cd_S / mass;
     // compute relative velocity
     VReal3 wind_rel_vel = vel - wind_vel;
     double wind_rel_vel_mod = wind_rel_vel.mod();
@@ -81,6 +165,117 @@ void BallisticModel::operator()(const State<3>& state, State<3>& state_dot,
     state_dot[4] = -k * wind_rel_vel_mod * wind_rel_vel[1];
     state_dot[5] = -k * wind_rel_vel_mod * wind_rel_vel[2] + g;
 }
+
+void BallisticModel::operator()(const State<3>& state, State<3>& state_dot,
+                                double t) {
+    VReal3 wind_vel = Vw(state, state.X(), t);
+
+    // compute cd_S
+    double cd_S = pc.CdS(state, t);
+    ballistic_rhs(state, wind_vel, cd_S, pc.mass(), state_dot);
+}
+
+void FixedBallisticModel::operator()(const State<3>& state,
+                                     State<3>& state_dot, double t) {
+    ballistic_rhs(state, Vw, CdS(t), pl_mass, state_dot);
+}
+
+/**
+ * Closed form descent from a quasi-steady state down to z = 0.
+ *
+ * Once the acceleration drops below tol the payload is assumed to track the
+ * local terminal velocity, which scales as exp(beta_atm * h / 2) with the
+ * density law of atm(), and to drift with the wind sampled at S. CdS and wind
+ * are frozen at their values in S, so the fast path only holds for a stable
+ * canopy in constant wind. The residual velocity transient is added as a first
+ * order correction with time constants vt / g (horizontal) and vt / 2g
+ * (vertical).
+ *
+ * @param S The current state, already past the transient.
+ * @param S_dot The derivative of S.
+ * @param wind_vel The wind velocity at S.
+ * @param cd_S The CdS at S.
+ * @param mass The payload mass.
+ * @param t The current time.
+ * @param tol Acceleration tolerance (m/s^2) that enables the jump.
+ * @param S_ground The state at z = 0, with its time set.
+ * @param err_bound Estimated bound (m) on the horizontal landing error.
+ * @return true if the jump was taken, false if S is not quasi-steady.
+ */
+static bool ballistic_tail(const State<3>& S, const State<3>& S_dot,
+                           const VReal3& wind_vel, double cd_S, double mass,
+                           double t, double tol, State<3>& S_ground,
+                           double& err_bound) {
+    if (S_dot.X_dot().mod() > tol) {
+        return false;
+    }
+
+    VReal3 pos = S.X();
+    VReal3 vel = S.X_dot();
+    double h = -pos[2];
+    if (h <= 0 || cd_S <= 0) {
+        return false;
+    }
+
+    // Terminal velocity at ground level and at the current altitude
+    double vt0 = std::sqrt(2 * g * mass / (rho0 * cd_S));
+    double vt = vt0 * exp(0.5 * beta_atm * h);
+    double wz = wind_vel[2];
+    if (vt + wz <= 0) {
+        return false;  // Updraft stronger than the descent rate
+    }
+
+    // Time to fall from h to 0 with dh/dt = -(vt0 * exp(beta_atm * h / 2) + wz)
+    double u = exp(0.5 * beta_atm * h);
+    double t_fall;
+    if (std::abs(wz) < 1e-9) {
+        t_fall = 2 / (beta_atm * vt0) * (1 - 1 / u);
+    } else {
+        t_fall = 2 / (beta_atm * wz) * log(u * (vt0 + wz) / (vt0 * u + wz));
+    }
+
+    // First order correction for the velocity transient still decaying
+    double tau_h = vt / g;
+    double tau_v = vt / (2 * g);
+    double du_x = vel[0] - wind_vel[0];
+    double du_y = vel[1] - wind_vel[1];
+    double dv_z = vel[2] - (vt + wz);
+    t_fall -= dv_z * tau_v / (vt + wz);
+
+    double w_h = std::hypot(wind_vel[0], wind_vel[1]);
+    double corr_h = std::hypot(du_x, du_y) * tau_h;
+    double corr_v = w_h * std::abs(dv_z) * tau_v / (vt + wz);
+    // Lag of the true velocity behind vt(h) as density grows while falling
+    double lag = w_h * h * beta_atm * vt / (4 * g);
+    err_bound = corr_h + corr_v + lag;
+
+    S_ground = State<3>{pos[0] + wind_vel[0] * t_fall + du_x * tau_h,
+                        pos[1] + wind_vel[1] * t_fall + du_y * tau_h,
+                        0,
+                        wind_vel[0],
+                        wind_vel[1],
+                        vt0 + wz};
+    S_ground(t + t_fall);
+    return true;
+}
+
+bool BallisticModel::terminal_tail(const State<3>& S, double t, double tol,
+                                   State<3>& S_ground, double& err_bound) {
+    State<3> S_dot;
+    (*this)(S, S_dot, t);
+    return ballistic_tail(S, S_dot, Vw(S, S.X(), t), pc.CdS(S, t), pc.mass(),
+                          t, tol, S_ground, err_bound);
+}
+
+bool FixedBallisticModel::terminal_tail(const State<3>& S, double t,
+                                        double tol, State<3>& S_ground,
+                                        double& err_bound) {
+    State<3> S_dot;
+    (*this)(S, S_dot, t);
+    return ballistic_tail(S, S_dot, Vw, CdS(t), pl_mass, t, tol, S_ground,
+                          err_bound);
+}
+
 /**
  * Calculates the initial state of a falling object based on the given
  * parameters.
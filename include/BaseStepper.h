@@ -12,6 +12,8 @@ class BaseStepper {
     virtual ~BaseStepper() {}  // Virtual destructor
     virtual void do_step(ModelType& model, State<N>& in, double t,
                          State<N>& out, double dt) = 0;
+    // Forgets what was cached from the previous run, before a new one
+    virtual void reset() {}
 };
 
 template <typename ModelType, size_t N = ModelType::getN()>
@@ -41,6 +43,8 @@ class RK45Stepper : public BaseStepper<ModelType> {
                  double dt) override {
         stepper.do_step(model, in, t, out, dt);
     }
+    // The derivative at the end of the last step is reused (FSAL)
+    void reset() override { stepper.reset(); }
 
    private:
     odeint::runge_kutta_dopri5<State<N>, double, State<N>, double,
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+/**
+ * @brief Landing mean and covariance on the ground (north, east).
+ *
+ * The covariance ellipse is given by its 1-sigma semi-axes and the direction
+ * of the major axis, rad from north towards east.
+ */
+struct LandingSpread {
+    double n = 0, e = 0;                 /**< Mean landing (m) */
+    double c_nn = 0, c_ne = 0, c_ee = 0; /**< Covariance (m^2) */
+
+    // Root mean square distance from the mean
+    double rms() const { return std::sqrt(c_nn + c_ee); }
+
+    double major() const { return std::sqrt(eigen(1)); }
+    double minor() const { return std::sqrt(eigen(-1)); }
+    double angle() const { return 0.5 * std::atan2(2 * c_ne, c_nn - c_ee); }
+
+    // Accumulates the outer product w * d d^T
+    void add(double w, double dn, double de) {
+        c_nn += w * dn * dn;
+        c_ne += w * dn * de;
+        c_ee += w * de * de;
+    }
+
+   private:
+    double eigen(int sign) const {
+        double mid = 0.5 * (c_nn + c_ee);
+        double r = std::hypot(0.5 * (c_nn - c_ee), c_ne);
+        return std::max(mid + sign * r, 0.0);
+    }
+};
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "QMC.h"
+
+/**
+ * @brief Quantization steps of the inputs of a cached drop.
+ *
+ * Inputs closer than a step share the same key, a step of 0 keys on the
+ * exact value.
+ */
+struct CacheTolerances {
+    double h = 0.01;          /**< Release altitude (m) */
+    double speed = 0.01;      /**< Ground speed (m/s) */
+    double heading = 1e-4;    /**< Heading (rad) */
+    double v_down = 0.01;     /**< Vertical speed (m/s) */
+    double wind_speed = 0.01; /**< Wind speed (m/s) */
+    double wind_dir = 1e-4;   /**< Wind direction (rad) */
+    double mass = 1e-4;       /**< Payload mass (kg) */
+    double cds = 1e-5;        /**< Canopy CdS (m^2) */
+    double dt = 0;            /**< Time step (s) */
+};
+
+/**
+ * @brief Inputs of a drop in the form they are needed to compute it.
+ */
+struct DropQuery {
+    double h, speed, heading, v_down;
+    double wind_speed, wind_dir;
+    double mass, cds;
+    double dt, time, tail_tol;
+    std::string method;
+};
+
+/**
+ * @brief Landing of a cached drop, relative to the release point, so the
+ * same entry serves any target.
+ */
+struct CachedDrop {
+    double north = 0, east = 0; /**< Landing offset (m) */
+    double tail_err = 0;        /**< Error bound of the terminal tail (m) */
+};
+
+/**
+ * @brief Sharded LRU cache of drops, keyed by the quantized inputs.
+ *
+ * The key space is split by hash over independent shards, each with its own
+ * mutex, list and map, so concurrent queries only contend when they fall in
+ * the same shard. Each shard evicts its least recently used entry once it
+ * holds capacity / shards entries. Hits and misses are counted per shard
+ * and summed by stats().
+ */
+class DropCache {
+   public:
+    static constexpr size_t N_FIELDS = 12;
+    using Key = std::array<int64_t, N_FIELDS>;
+
+    struct Stats {
+        uint64_t hits = 0, misses = 0;
+        size_t size = 0, capacity = 0;
+    };
+
+    DropCache(size_t capacity, size_t n_shards = 16,
+              const CacheTolerances& tol = {})
+        : tol(tol), shards(n_shards ? n_shards : 1) {
+        if (capacity == 0) {
+            throw std::invalid_argument("Cache capacity must be positive");
+        }
+        shard_capacity = (capacity + shards.size() - 1) / shards.size();
+    }
+
+    const CacheTolerances& tolerances() const { return tol; }
+
+    Key key(const DropQuery& q) const {
+        return {quantize(q.h, tol.h),
+                quantize(q.speed, tol.speed),
+                quantize(q.heading, tol.heading),
+                quantize(q.v_down, tol.v_down),
+                quantize(q.wind_speed, tol.wind_speed),
+                quantize(q.wind_dir, tol.wind_dir),
+                quantize(q.mass, tol.mass),
+                quantize(q.cds, tol.cds),
+                quantize(q.dt, tol.dt),
+                quantize(q.time, 0),
+                quantize(q.tail_tol, 0),
+                int64_t(std::hash<std::string>{}(q.method))};
+    }
+
+    /**
+     * @brief Looks up a drop and marks it as the most recently used.
+     *
+     * @return true and the landing in out on a hit, false on a miss.
+     */
+    bool find(const Key& k, CachedDrop& out) {
+        Shard& s = shard(k);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        auto it = s.map.find(k);
+        if (it == s.map.end()) {
+            s.misses++;
+            return false;
+        }
+        s.lru.splice(s.lru.begin(), s.lru, it->second);
+        out = it->second->second;
+        s.hits++;
+        return true;
+    }
+
+    void insert(const Key& k, const CachedDrop& value) {
+        Shard& s = shard(k);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        auto it = s.map.find(k);
+        if (it != s.map.end()) {
+            it->second->second = value;
+            s.lru.splice(s.lru.begin(), s.lru, it->second);
+            return;
+        }
+        if (s.map.size() >= shard_capacity) {
+            s.map.erase(s.lru.back().first);
+            s.lru.pop_back();
+        }
+        s.lru.emplace_front(k, value);
+        s.map.emplace(k, s.lru.begin());
+    }
+
+    Stats stats() const {
+        Stats st;
+        st.capacity = shard_capacity * shards.size();
+        for (const Shard& s : shards) {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            st.hits += s.hits;
+            st.misses += s.misses;
+            st.size += s.map.size();
+        }
+        return st;
+    }
+
+    // Drops all the entries and resets the counters
+    void clear() {
+        for (Shard& s : shards) {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            s.map.clear();
+            s.lru.clear();
+            s.hits = s.misses = 0;
+        }
+    }
+
+   private:
+    struct KeyHash {
+        size_t operator()(const Key& k) const {
+            uint64_t h = 0;
+            for (int64_t v : k) {
+                h = mix64(h ^ uint64_t(v));
+            }
+            return size_t(h);
+        }
+    };
+
+    using Entry = std::pair<Key, CachedDrop>;
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::list<Entry> lru;  // Most recently used first
+        std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> map;
+        uint64_t hits = 0, misses = 0;
+    };
+
+    static int64_t quantize(double x, double step) {
+        if (step > 0) {
+            return std::llround(x / step);
+        }
+        int64_t bits;
+        x = x == 0 ? 0 : x;  // -0 and +0 share the key
+        std::memcpy(&bits, &x, sizeof bits);
+        return bits;
+    }
+
+    Shard& shard(const Key& k) {
+        // High bits pick the shard, the low ones the bucket inside it
+        return shards[(KeyHash{}(k) >> 40) % shards.size()];
+    }
+
+    CacheTolerances tol;
+    std::vector<Shard> shards;
+    size_t shard_capacity;
+};
@@ -0,0 +1,386 @@
+#pragma once
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "BallisticModel.h"
+#include "LatencyStats.h"
+#include "Protocol.h"
+#include "Simulation.h"
+#include "State.h"
+#include "Waypoint.h"
+
+/**
+ * @brief Drop point and trajectory server over a Unix domain socket, see
+ * Protocol.h.
+ *
+ * Each connection has a thread that reads its requests and queues them.
+ * A single batcher thread takes everything queued once max_batch launches
+ * are waiting or the oldest request has waited max_wait, groups the
+ * requests with the same settings and runs each group as one parallel
+ * batch. So concurrent clients share the integrator threads instead of
+ * running their small batches one after the other.
+ */
+class DropServer {
+   public:
+    struct Options {
+        std::string path = "/tmp/sft_fall_model.sock";
+        size_t max_batch = 4096; /**< Launches that trigger a batch */
+        std::chrono::microseconds max_wait{500}; /**< Max queueing delay */
+        double report_s = 0; /**< Period of the stats on stderr, 0 = off */
+    };
+
+    explicit DropServer(const Options& opt) : opt(opt) {}
+
+    DropServer(const DropServer&) = delete;
+    DropServer& operator=(const DropServer&) = delete;
+
+    ~DropServer() {
+        if (listen_fd >= 0) ::close(listen_fd);
+    }
+
+    /**
+     * @brief Binds the socket and serves until request_stop().
+     *
+     * @throws std::runtime_error if the socket cannot be bound.
+     */
+    void run();
+
+    // Async signal safe, run() returns within 100 ms
+    void request_stop() { stopping.store(true); }
+
+    proto::ServerStats stats() const;
+
+   private:
+    struct Pending {
+        proto::RequestHeader head;
+        std::vector<proto::Launch> launches;
+        std::vector<char> reply;
+        bool done = false;
+    };
+
+    void serve(int fd);
+    // Joins the connections that ended, so they do not pile up until stop
+    void reap(std::vector<std::thread>& conns);
+    void batch_loop();
+    void run_group(std::span<Pending*> group);
+    void report();
+
+    static bool same_settings(const proto::RequestHeader& a,
+                              const proto::RequestHeader& b) {
+        return a.type == b.type && a.time == b.time && a.step == b.step &&
+               a.tail_tol == b.tail_tol &&
+               std::strncmp(a.method, b.method, sizeof(a.method)) == 0;
+    }
+
+    static std::vector<char> reply_header(const proto::RequestHeader& req,
+                                          uint16_t status, uint32_t count) {
+        proto::ReplyHeader head;
+        head.type = req.type;
+        head.status = status;
+        head.id = req.id;
+        head.count = count;
+        std::vector<char> buf(sizeof(head));
+        std::memcpy(buf.data(), &head, sizeof(head));
+        return buf;
+    }
+
+    template <typename T>
+    static void append(std::vector<char>& buf, const T* data, size_t n) {
+        const char* p = reinterpret_cast<const char*>(data);
+        buf.insert(buf.end(), p, p + n * sizeof(T));
+    }
+
+    Options opt;
+    int listen_fd = -1;
+    std::atomic<bool> stopping{false};
+    std::chrono::steady_clock::time_point start;
+
+    std::mutex queue_mutex;
+    std::condition_variable queue_cv;  // Wakes the batcher
+    std::condition_variable done_cv;   // Wakes the connections
+    std::deque<std::pair<Pending*, std::chrono::steady_clock::time_point>>
+        queue;
+    size_t queued_launches = 0;
+
+    std::mutex clients_mutex;
+    std::vector<int> clients;
+    std::vector<std::thread::id> finished;  // Connections to join
+
+    LatencyStats latency;
+    std::atomic<uint64_t> n_launches{0}, n_batches{0};
+};
+
+inline void DropServer::run() {
+    sockaddr_un addr = proto::socket_address(opt.path);
+    listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        throw std::runtime_error("Cannot create the socket");
+    }
+    ::unlink(opt.path.c_str());
+    if (::bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) !=
+            0 ||
+        ::listen(listen_fd, 128) != 0) {
+        throw std::runtime_error("Cannot bind " + opt.path + ": " +
+                                 std::strerror(errno));
+    }
+    start = std::chrono::steady_clock::now();
+
+    std::thread batcher(&DropServer::batch_loop, this);
+    std::vector<std::thread> conns;
+    auto last_report = start;
+    while (!stopping.load()) {
+        pollfd pfd{listen_fd, POLLIN, 0};
+        if (::poll(&pfd, 1, 100) > 0 && (pfd.revents & POLLIN)) {
+            int fd = ::accept(listen_fd, nullptr, nullptr);
+            if (fd >= 0) {
+                std::lock_guard<std::mutex> lock(clients_mutex);
+                clients.push_back(fd);
+                conns.emplace_back(&DropServer::serve, this, fd);
+            }
+        }
+        reap(conns);
+        auto now = std::chrono::steady_clock::now();
+        if (opt.report_s > 0 &&
+            std::chrono::duration<double>(now - last_report).count() >=
+                opt.report_s) {
+            report();
+            last_report = now;
+        }
+    }
+
+    // Unblock the connections, then the batcher
+    {
+        std::lock_guard<std::mutex> lock(clients_mutex);
+        for (int fd : clients) ::shutdown(fd, SHUT_RDWR);
+    }
+    for (auto& t : conns) t.join();
+    queue_cv.notify_all();
+    batcher.join();
+    ::close(listen_fd);
+    listen_fd = -1;
+    ::unlink(opt.path.c_str());
+    if (opt.report_s > 0) report();
+}
+
+inline proto::ServerStats DropServer::stats() const {
+    proto::ServerStats st;
+    st.requests = latency.size();
+    st.launches = n_launches.load();
+    st.batches = n_batches.load();
+    st.p50_us = latency.percentile(0.50);
+    st.p99_us = latency.percentile(0.99);
+    double elapsed = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    st.throughput = elapsed > 0 ? double(st.requests) / elapsed : 0;
+    return st;
+}
+
+inline void DropServer::report() {
+    proto::ServerStats st = stats();
+    std::fprintf(stderr,
+                 "requests %llu  launches %llu  batches %llu  p50 %.1f us  "
+                 "p99 %.1f us  %.1f req/s\n",
+                 (unsigned long long)st.requests,
+                 (unsigned long long)st.launches,
+                 (unsigned long long)st.batches, st.p50_us, st.p99_us,
+                 st.throughput);
+}
+
+inline void DropServer::serve(int fd) {
+    Pending p;
+    while (!stopping.load() && proto::read_full(fd, &p.head, sizeof(p.head))) {
+        auto t_recv = std::chrono::steady_clock::now();
+        if (p.head.magic != proto::MAGIC ||
+            p.head.count > proto::MAX_LAUNCHES) {
+            break;  // Out of sync, drop the connection
+        }
+        p.launches.resize(p.head.count);
+        if (!proto::read_full(fd, p.launches.data(),
+                              p.launches.size() * sizeof(proto::Launch))) {
+            break;
+        }
+        p.head.method[sizeof(p.head.method) - 1] = '\0';
+
+        if (p.head.type == proto::STATS) {
+            p.reply = reply_header(p.head, proto::OK, 1);
+            proto::ServerStats st = stats();
+            append(p.reply, &st, 1);
+        } else if (p.head.type != proto::DROP &&
+                   p.head.type != proto::TRAJECTORY) {
+            p.reply = reply_header(p.head, proto::BAD_REQUEST, 0);
+        } else {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            if (stopping.load()) break;  // The batcher may be gone
+            p.done = false;
+            queue.emplace_back(&p, t_recv);
+            queued_launches += p.launches.size();
+            queue_cv.notify_one();
+            done_cv.wait(lock, [&] { return p.done; });
+        }
+        if (!proto::write_full(fd, p.reply.data(), p.reply.size())) {
+            break;
+        }
+        if (p.head.type != proto::STATS) {
+            latency.record(std::chrono::duration<double, std::micro>(
+                               std::chrono::steady_clock::now() - t_recv)
+                               .count());
+        }
+    }
+    std::lock_guard<std::mutex> lock(clients_mutex);
+    clients.erase(std::find(clients.begin(), clients.end(), fd));
+    ::close(fd);
+    finished.push_back(std::this_thread::get_id());
+}
+
+inline void DropServer::reap(std::vector<std::thread>& conns) {
+    std::vector<std::thread::id> ids;
+    {
+        std::lock_guard<std::mutex> lock(clients_mutex);
+        ids.swap(finished);
+    }
+    if (ids.empty()) return;
+    // The threads are past their last lock, the joins return at once
+    for (auto it = conns.begin(); it != conns.end();) {
+        if (std::find(ids.begin(), ids.end(), it->get_id()) != ids.end()) {
+            it->join();
+            it = conns.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+inline void DropServer::batch_loop() {
+    std::vector<Pending*> taken;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            queue_cv.wait(lock, [&] { return stopping.load() || !queue.empty(); });
+            if (queue.empty()) return;  // Stopping, connections are gone
+            // Let concurrent requests join, up to max_wait from the oldest
+            auto deadline = queue.front().second + opt.max_wait;
+            queue_cv.wait_until(lock, deadline, [&] {
+                return stopping.load() || queued_launches >= opt.max_batch;
+            });
+            for (auto& q : queue) taken.push_back(q.first);
+            queue.clear();
+            queued_launches = 0;
+        }
+
+        // One group per distinct settings, arrival order inside
+        std::vector<std::vector<Pending*>> groups;
+        for (Pending* p : taken) {
+            auto g = std::find_if(groups.begin(), groups.end(), [&](auto& g) {
+                return same_settings(g[0]->head, p->head);
+            });
+            if (g == groups.end()) {
+                groups.push_back({p});
+            } else {
+                g->push_back(p);
+            }
+        }
+        for (auto& g : groups) {
+            run_group(g);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            for (Pending* p : taken) p->done = true;
+        }
+        done_cv.notify_all();
+        taken.clear();
+    }
+}
+
+inline void DropServer::run_group(std::span<Pending*> group) {
+    const proto::RequestHeader& head = group[0]->head;
+    size_t n = 0;
+    for (Pending* p : group) n += p->launches.size();
+
+    LaunchBatch batch;
+    std::vector<State<3>> v_S0;
+    batch.reserve(n);
+    v_S0.reserve(n);
+    for (Pending* p : group) {
+        for (const proto::Launch& l : p->launches) {
+            batch.push_back(l.mass, l.cds,
+                            VReal3{l.wind_speed * cos(l.wind_dir),
+                                   l.wind_speed * sin(l.wind_dir), 0},
+                            1);
+            v_S0.push_back(State<3>{0, 0, -l.h, l.vel_speed * cos(l.vel_head),
+                                    l.vel_speed * sin(l.vel_head), l.v_down});
+        }
+    }
+
+    try {
+        Simulation s(head.step, head.time, head.method);
+        s.set_terminal_tail(head.tail_tol);
+        size_t offset = 0;
+        if (head.type == proto::DROP) {
+            s.set_priority(Priority::LIVE);
+            size_t chunk = std::max<size_t>(1, n / (4 * N_THREADS));
+            std::vector<State<3>> last =
+                s.run_parallel_sweep(LaunchSweep{batch, v_S0}, chunk);
+            for (Pending* p : group) {
+                p->reply = reply_header(p->head, proto::OK, p->launches.size());
+                for (const proto::Launch& l : p->launches) {
+                    double north = last[offset].X()[0];
+                    double east = last[offset].X()[1];
+                    double gps[2];
+                    get_drop_batch(GeoFrame(GPS{l.lat, l.lon}), &north, &east,
+                                   1, &gps[0], &gps[1]);
+                    append(p->reply, gps, 2);
+                    offset++;
+                }
+            }
+        } else {
+            Results<3> res =
+                s.run_parallel_batch(batch, std::span<State<3>>(v_S0));
+            for (Pending* p : group) {
+                p->reply = reply_header(p->head, proto::OK, p->launches.size());
+                for (size_t i = 0; i < p->launches.size(); i++, offset++) {
+                    auto traj = res[offset];
+                    uint32_t len = traj.size();
+                    append(p->reply, &len, 1);
+                    for (const State<3>& S : traj) {
+                        // Vertical axis up, as trajectories()
+                        double row[7] = {S.X()[0],     S.X()[1],
+                                         -S.X()[2],    S.X_dot()[0],
+                                         S.X_dot()[1], -S.X_dot()[2],
+                                         S.get_t()};
+                        append(p->reply, row, 7);
+                    }
+                }
+            }
+        }
+        n_launches += n;
+        n_batches++;
+    } catch (std::invalid_argument&) {
+        for (Pending* p : group) {
+            p->reply = reply_header(p->head, proto::BAD_REQUEST, 0);
+        }
+    } catch (std::exception&) {
+        for (Pending* p : group) {
+            p->reply = reply_header(p->head, proto::FAILED, 0);
+        }
+    }
+}
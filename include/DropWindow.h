@@ -0,0 +1,233 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "BallisticModel.h"
+#include "Simulation.h"
+#include "State.h"
+#include "Waypoint.h"
+
+/**
+ * @brief Straight approach leg flown at constant airspeed.
+ *
+ * Positions along the leg are given by the distance s from the start, the
+ * altitude by a piecewise linear profile over s (constant past the ends).
+ */
+struct FlightLine {
+    GPS start;          /**< Start of the leg */
+    double heading = 0; /**< Track (rad), 0 = north */
+    double speed = 0;   /**< Ground speed at release (m/s) */
+    double v_down = 0;  /**< Vertical speed at release (m/s), NED */
+    double length = 0;  /**< Length of the leg (m) */
+    std::vector<std::pair<double, double>> profile; /**< {s (m), h (m)},
+                                                       sorted by s */
+
+    double altitude(double s) const {
+        if (profile.empty()) {
+            throw std::invalid_argument("Empty altitude profile");
+        }
+        if (s <= profile.front().first) {
+            return profile.front().second;
+        }
+        if (s >= profile.back().first) {
+            return profile.back().second;
+        }
+        auto it = std::upper_bound(
+            profile.begin(), profile.end(), s,
+            [](double s, const std::pair<double, double>& k) {
+                return s < k.first;
+            });
+        auto [s0, h0] = *(it - 1);
+        auto [s1, h1] = *it;
+        return h0 + (h1 - h0) * (s - s0) / (s1 - s0);
+    }
+};
+
+/**
+ * @brief Stretch of a flight line whose releases land within the radius.
+ *
+ * Distances s are measured along the line from its start. When no release
+ * lands within the radius found is false and only the best release is set.
+ */
+struct DropWindow {
+    bool found = false;
+    double s_begin = 0, s_end = 0; /**< Window along the line (m) */
+    GPS begin, end;                /**< Window endpoints */
+    std::vector<GPS> waypoints;    /**< way_array of the window center */
+    double s_best = 0;             /**< Release closest to the target (m) */
+    double miss_best = 0;          /**< Its landing distance (m) */
+};
+
+/**
+ * @brief Releases at given distances along a flight line, in the sweep
+ * interface of Simulation::run_parallel_sweep.
+ *
+ * Initial states are in the local north/east frame of the target, so the
+ * landing distance from the target is the norm of the last position.
+ */
+struct FlightLineReleases {
+    const FlightLine& line;
+    FixedBallisticModel model;
+    double north0, east0;  // Start of the line in the target frame
+    std::vector<double> s;
+
+    size_t size() const { return s.size(); }
+
+    std::pair<FixedBallisticModel, State<3>> at(size_t idx) const {
+        double c = cos(line.heading), sn = sin(line.heading);
+        State<3> S0{north0 + s[idx] * c,
+                    east0 + s[idx] * sn,
+                    -line.altitude(s[idx]),
+                    line.speed * c,
+                    line.speed * sn,
+                    line.v_down};
+        return {model, S0};
+    }
+};
+
+/**
+ * @brief Finds the window of a flight line whose releases land within radius
+ * meters of the target.
+ *
+ * The line is scanned at n_scan evenly spaced releases, simulated in
+ * parallel. If no release of the scan lands within the radius, the closest one
+ * is refined by a ternary search. The edges of the window around the closest
+ * release are bracketed by the scan and refined by bisection, both edges at
+ * once so that each iteration runs two simulations in parallel. The window is
+ * assumed to be a single interval, which holds for straight legs at constant
+ * speed unless the altitude profile is very irregular.
+ *
+ * @param sim Simulation settings (integrator, dt, T).
+ * @param line The flight line.
+ * @param target Ground target.
+ * @param radius Acceptance radius around the target (m).
+ * @param model Payload model, constant along the line.
+ * @param n_scan Releases of the initial scan.
+ * @param tol Accuracy of the window edges (m).
+ * @param way_d Distance of the first and last waypoint from the center (m),
+ * 0 = half the window, so the waypoints are the window endpoints.
+ */
+inline DropWindow find_drop_window(Simulation& sim, const FlightLine& line,
+                                   const GPS& target, double radius,
+                                   const FixedBallisticModel& model,
+                                   size_t n_scan = 64, double tol = 0.1,
+                                   double way_d = 0) {
+    if (line.length <= 0 || n_scan < 2) {
+        throw std::invalid_argument("Flight line needs length > 0, n_scan > 1");
+    }
+    GeoFrame frame(target);
+    double north0, east0;
+    frame.to_enu(&line.start.lat, &line.start.lon, 1, &north0, &east0);
+    FlightLineReleases rel{line, model, north0, east0, {}};
+
+    // Landing distance from the target of the releases at s
+    auto miss = [&](std::vector<double> s) {
+        rel.s = std::move(s);
+        std::vector<State<3>> last = sim.run_parallel_sweep(rel, 1);
+        std::vector<double> d(last.size());
+        for (size_t i = 0; i < last.size(); i++) {
+            d[i] = hypot(last[i].X()[0], last[i].X()[1]);
+        }
+        return d;
+    };
+    auto point = [&](double s) {
+        return translate_gps(line.start, s, line.heading);
+    };
+
+    DropWindow w;
+    std::vector<double> s_scan(n_scan);
+    for (size_t i = 0; i < n_scan; i++) {
+        s_scan[i] = line.length * double(i) / double(n_scan - 1);
+    }
+    std::vector<double> d_scan = miss(s_scan);
+    size_t i_best = std::min_element(d_scan.begin(), d_scan.end()) -
+                    d_scan.begin();
+    w.s_best = s_scan[i_best];
+    w.miss_best = d_scan[i_best];
+
+    if (w.miss_best > radius) {
+        // The window may fall between two scan points, ternary search
+        double lo = s_scan[i_best > 0 ? i_best - 1 : 0];
+        double hi = s_scan[std::min(i_best + 1, n_scan - 1)];
+        while (hi - lo > tol && w.miss_best > radius) {
+            double a = lo + (hi - lo) / 3, b = hi - (hi - lo) / 3;
+            std::vector<double> d = miss({a, b});
+            if (d[0] < d[1]) {
+                hi = b;
+            } else {
+                lo = a;
+            }
+            size_t k = d[0] < d[1] ? 0 : 1;
+            if (d[k] < w.miss_best) {
+                w.s_best = k == 0 ? a : b;
+                w.miss_best = d[k];
+            }
+        }
+        if (w.miss_best > radius) {
+            return w;
+        }
+    }
+
+    // Brackets [out, in] of the two edges, clamped to the ends of the line
+    double in_lo = w.s_best, in_hi = w.s_best;
+    double out_lo = in_lo, out_hi = in_hi;
+    bool open_lo = true, open_hi = true;  // Edge at the end of the line
+    if (d_scan[i_best] > radius) {
+        // Window found by the ternary search, between two scan points
+        auto it = std::lower_bound(s_scan.begin(), s_scan.end(), w.s_best);
+        if (it != s_scan.begin()) {
+            out_lo = *(it - 1);
+            open_lo = false;
+        }
+        it = std::upper_bound(s_scan.begin(), s_scan.end(), w.s_best);
+        if (it != s_scan.end()) {
+            out_hi = *it;
+            open_hi = false;
+        }
+    } else {
+        for (size_t j = i_best; j-- > 0;) {
+            if (d_scan[j] > radius) {
+                out_lo = s_scan[j];
+                open_lo = false;
+                break;
+            }
+            in_lo = s_scan[j];
+        }
+        for (size_t j = i_best + 1; j < n_scan; j++) {
+            if (d_scan[j] > radius) {
+                out_hi = s_scan[j];
+                open_hi = false;
+                break;
+            }
+            in_hi = s_scan[j];
+        }
+    }
+    if (open_lo) {
+        in_lo = out_lo = 0;
+    }
+    if (open_hi) {
+        in_hi = out_hi = line.length;
+    }
+
+    // Bisection of both edges, one parallel run per iteration
+    while (std::abs(in_lo - out_lo) > tol || std::abs(out_hi - in_hi) > tol) {
+        double m_lo = 0.5 * (in_lo + out_lo), m_hi = 0.5 * (in_hi + out_hi);
+        std::vector<double> d = miss({m_lo, m_hi});
+        (d[0] <= radius ? in_lo : out_lo) = m_lo;
+        (d[1] <= radius ? in_hi : out_hi) = m_hi;
+    }
+
+    w.found = true;
+    w.s_begin = in_lo;
+    w.s_end = in_hi;
+    w.begin = point(w.s_begin);
+    w.end = point(w.s_end);
+    double half = 0.5 * (w.s_end - w.s_begin);
+    w.waypoints = way_array(point(w.s_begin + half), line.heading,
+                            way_d > 0 ? way_d : std::max(half, tol));
+    return w;
+}
@@ -0,0 +1,257 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "LatencyStats.h"
+
+/**
+ * @brief Priority classes of the parallel work, highest first.
+ *
+ *  - LIVE: queries someone is waiting for, e.g. the autopilot drop point.
+ *  - NORMAL: default of Simulation.
+ *  - BULK: background sweeps, Monte Carlo, calibrations.
+ */
+enum class Priority { LIVE = 0, NORMAL = 1, BULK = 2 };
+
+constexpr size_t N_PRIORITIES = 3;
+
+/**
+ * @brief Counters of one priority class of the Executor.
+ */
+struct ExecutorStats {
+    uint64_t jobs = 0;   /**< Jobs submitted */
+    uint64_t chunks = 0; /**< Chunks run */
+    double p50_us = 0;   /**< Queueing latency, submit to first chunk (us) */
+    double p99_us = 0;
+};
+
+/**
+ * @brief Shared pool of worker threads with priority classes.
+ *
+ * A job is a range of indices cut in chunks. Workers always take the next
+ * chunk of the highest priority job that has one left, so a job only
+ * waits for the chunks already running: bulk work yields at chunk
+ * boundaries. The first `reserved` workers never take anything but LIVE
+ * chunks, and a LIVE caller runs chunks of its own job too, so live
+ * queries start at once even when the pool is saturated.
+ *
+ * A parallel_for called from inside a chunk, on a worker of the same pool,
+ * runs inline on that worker: waiting for the other workers there could
+ * deadlock once they all wait on nested jobs.
+ */
+class Executor {
+   public:
+    explicit Executor(size_t n_workers, size_t reserved = 0)
+        : reserved(reserved) {
+        n_workers = std::max<size_t>(n_workers, 1);
+        for (size_t i = 0; i < n_workers; i++) {
+            workers.emplace_back(&Executor::work, this, i);
+        }
+    }
+
+    Executor(const Executor&) = delete;
+    Executor& operator=(const Executor&) = delete;
+
+    ~Executor() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        work_cv.notify_all();
+        for (auto& t : workers) t.join();
+    }
+
+    /**
+     * @brief Pool behind Simulation, one worker per hardware thread and
+     * one of them reserved to LIVE work when there are more than 2.
+     */
+    static Executor& shared() {
+        static Executor ex(std::max(1u, std::thread::hardware_concurrency()),
+                           std::thread::hardware_concurrency() > 2 ? 1 : 0);
+        return ex;
+    }
+
+    size_t size() const { return workers.size(); }
+
+    // Index of the calling thread among the workers, size() if it is not
+    // one of them, e.g. a LIVE caller running chunks of its own job
+    size_t worker_index() const {
+        return current == this ? current_id : workers.size();
+    }
+
+    // Workers kept for LIVE work, at most size() - 1
+    void set_reserved(size_t n) {
+        reserved.store(std::min(n, workers.size() - 1));
+        work_cv.notify_all();
+    }
+
+    /**
+     * @brief Runs fn(begin, end) over [0, n) in chunks and waits for it.
+     *
+     * The first exception thrown by fn is rethrown here, once the chunks
+     * already started are over; the chunks not started yet are skipped.
+     * Called from a worker of this pool, the chunks run inline, in order.
+     *
+     * @param p Priority class of the job.
+     * @param n Number of indices.
+     * @param chunk Indices per chunk.
+     * @param fn Callable void(size_t begin, size_t end).
+     */
+    template <typename F>
+    void parallel_for(Priority p, size_t n, size_t chunk, F&& fn) {
+        if (n == 0) return;
+        if (current == this) {
+            chunk = std::max<size_t>(chunk, 1);
+            for (size_t begin = 0; begin < n; begin += chunk) {
+                fn(begin, std::min(begin + chunk, n));
+            }
+            return;
+        }
+        Job job;
+        job.p = p;
+        job.n = n;
+        job.chunk = std::max<size_t>(chunk, 1);
+        job.n_chunks = (n + job.chunk - 1) / job.chunk;
+        job.remaining = job.n_chunks;
+        job.ctx = &fn;
+        job.call = [](void* ctx, size_t begin, size_t end) {
+            (*static_cast<std::remove_reference_t<F>*>(ctx))(begin, end);
+        };
+        job.submit = std::chrono::steady_clock::now();
+        const size_t c = size_t(p);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queues[c].push_back(&job);
+            n_jobs[c]++;
+        }
+        work_cv.notify_all();
+
+        if (p == Priority::LIVE) {
+            // The caller is one more worker of its own job
+            size_t k;
+            while (claim(job, k)) run_chunk(job, k);
+        }
+        std::unique_lock<std::mutex> lock(done_mutex);
+        done_cv.wait(lock, [&] { return job.remaining == 0; });
+        if (job.error) std::rethrow_exception(job.error);
+    }
+
+    ExecutorStats stats(Priority p) const {
+        const size_t c = size_t(p);
+        ExecutorStats st;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            st.jobs = n_jobs[c];
+            st.chunks = n_chunks[c];
+        }
+        st.p50_us = latency[c].percentile(0.50);
+        st.p99_us = latency[c].percentile(0.99);
+        return st;
+    }
+
+   private:
+    struct Job {
+        Priority p;
+        size_t n, chunk, n_chunks;
+        size_t next = 0;       // Next chunk to claim, under mutex
+        size_t remaining = 0;  // Chunks not over, under done_mutex
+        void* ctx;
+        void (*call)(void*, size_t, size_t);
+        std::chrono::steady_clock::time_point submit;
+        std::exception_ptr error;  // Under done_mutex
+    };
+
+    // Claims the next chunk of job, false once they are all claimed
+    bool claim(Job& job, size_t& k) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return claim_locked(job, k);
+    }
+
+    bool claim_locked(Job& job, size_t& k) {
+        if (job.next >= job.n_chunks) return false;
+        k = job.next++;
+        const size_t c = size_t(job.p);
+        if (k == 0) {
+            latency[c].record(std::chrono::duration<double, std::micro>(
+                                  std::chrono::steady_clock::now() - job.submit)
+                                  .count());
+        }
+        n_chunks[c]++;
+        if (job.next == job.n_chunks) {
+            auto& q = queues[c];
+            q.erase(std::find(q.begin(), q.end(), &job));
+        }
+        return true;
+    }
+
+    void run_chunk(Job& job, size_t k) {
+        bool skip;
+        {
+            std::lock_guard<std::mutex> lock(done_mutex);
+            skip = bool(job.error);
+        }
+        if (!skip) {
+            size_t begin = k * job.chunk;
+            try {
+                job.call(job.ctx, begin, std::min(begin + job.chunk, job.n));
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(done_mutex);
+                if (!job.error) job.error = std::current_exception();
+            }
+        }
+        // Last access to job, the caller may return as soon as it is 0
+        std::lock_guard<std::mutex> lock(done_mutex);
+        if (--job.remaining == 0) done_cv.notify_all();
+    }
+
+    void work(size_t id) {
+        current = this;
+        current_id = id;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            Job* job = nullptr;
+            size_t k = 0;
+            work_cv.wait(lock, [&] {
+                if (stopping) return true;
+                size_t n_classes = id < reserved.load() ? 1 : N_PRIORITIES;
+                for (size_t c = 0; c < n_classes && !job; c++) {
+                    if (!queues[c].empty()) job = queues[c].front();
+                }
+                return job != nullptr;
+            });
+            if (!job) return;  // Stopping and nothing to do
+            claim_locked(*job, k);
+            lock.unlock();
+            run_chunk(*job, k);
+            lock.lock();
+        }
+    }
+
+    // Pool and index of the worker running on this thread, if any
+    static inline thread_local const Executor* current = nullptr;
+    static inline thread_local size_t current_id = 0;
+
+    std::atomic<size_t> reserved;
+    std::vector<std::thread> workers;
+
+    mutable std::mutex mutex;  // Queues, claims and counters
+    std::condition_variable work_cv;
+    std::array<std::deque<Job*>, N_PRIORITIES> queues;
+    std::array<uint64_t, N_PRIORITIES> n_jobs{}, n_chunks{};
+    std::array<LatencyStats, N_PRIORITIES> latency;
+    bool stopping = false;
+
+    std::mutex done_mutex;  // Remaining chunks and errors of the jobs
+    std::condition_variable done_cv;
+};
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "BallisticModel.h"
+#include "State.h"
+#include "VReal.h"
+#include "Waypoint.h"
+#include "WindInversion.h"
+
+// Knots to m/s of the logged METAR winds, the same factor as the bridge
+constexpr double LOG_KT2M = 0.541;
+
+/**
+ * @brief One flight of a log in the test2.csv format.
+ */
+struct FlightRecord {
+    double wind_dir = 0;    /**< METAR wind direction (rad) */
+    double wind_speed = 0;  /**< METAR wind speed (m/s) */
+    GPS drop;               /**< Release point */
+    double h = 0;           /**< Release altitude above the landing (m) */
+    double head = 0;        /**< Heading of the UAV (rad) */
+    double vel = 0;         /**< Ground speed of the UAV (m/s) */
+    double v_down = 0;      /**< Vertical velocity (m/s), NED */
+    GPS land;               /**< Landing point */
+    double mass = 1;        /**< Payload mass (kg) */
+    double t_open = 1;      /**< Canopy opening time (s) */
+    double t_land = 0;      /**< Logged fall time (s) */
+
+    // Wind vector (NED), same convention as dropPoints
+    VReal3 wind() const {
+        return VReal3{wind_speed * std::cos(wind_dir),
+                      wind_speed * std::sin(wind_dir), 0};
+    }
+
+    // Release state, above the origin
+    State<3> release() const {
+        return State<3>{0, 0, -h, vel * std::cos(head), vel * std::sin(head),
+                        v_down};
+    }
+
+    // Logged landing (north, east) relative to the release (m)
+    std::pair<double, double> landing() const {
+        double n, e;
+        GeoFrame(drop).to_enu(&land.lat, &land.lon, 1, &n, &e);
+        return {n, e};
+    }
+
+    // Drop of the wind inversion, see WindInversion.h
+    RecordedDrop recorded() const {
+        RecordedDrop d;
+        State<3> S0 = release();
+        d.h = h;
+        d.vel_n = S0.X_dot()[0];
+        d.vel_e = S0.X_dot()[1];
+        d.vel_d = v_down;
+        d.mass = mass;
+        std::tie(d.land_n, d.land_e) = landing();
+        d.wind_n = wind()[0];
+        d.wind_e = wind()[1];
+        return d;
+    }
+};
+
+namespace flight_log {
+
+// Next whitespace separated token of line from pos, empty at the end
+inline std::string_view next_token(std::string_view line, size_t& pos) {
+    while (pos < line.size() && (line[pos] == ' ' || line[pos] == '\t' ||
+                                 line[pos] == '\r')) {
+        pos++;
+    }
+    size_t begin = pos;
+    while (pos < line.size() && line[pos] != ' ' && line[pos] != '\t' &&
+           line[pos] != '\r') {
+        pos++;
+    }
+    return line.substr(begin, pos - begin);
+}
+
+inline bool parse_double(std::string_view tok, double& v) {
+    auto [end, ec] = std::from_chars(tok.data(), tok.data() + tok.size(), v);
+    return ec == std::errc() && end == tok.data() + tok.size();
+}
+
+// dddss[s][Gxx]KT: direction (deg) and mean speed (kt), gusts ignored
+inline bool parse_metar(std::string_view tok, double& dir, double& speed) {
+    if (tok.size() < 7 || tok.substr(tok.size() - 2) != "KT") return false;
+    int deg = 0, kt = 0;
+    auto r1 = std::from_chars(tok.data(), tok.data() + 3, deg);
+    if (r1.ec != std::errc() || r1.ptr != tok.data() + 3) return false;
+    const char* end = tok.data() + tok.size() - 2;
+    auto r2 = std::from_chars(tok.data() + 3, end, kt);
+    if (r2.ec != std::errc() || (r2.ptr != end && *r2.ptr != 'G')) {
+        return false;
+    }
+    dir = deg * M_PI / 180.0;
+    speed = kt * LOG_KT2M;
+    return true;
+}
+
+}  // namespace flight_log
+
+/**
+ * @brief Parses a flight log in the test2.csv format.
+ *
+ * Whitespace separated columns with a header line, the columns are found
+ * by name and may come in any order, extra columns are ignored:
+ *
+ *     wind Lat_drop Long_drop H Head Vel V_down Lat_land Long_land mass
+ *     t_open t_land
+ *
+ * wind is a METAR group like 06800KT, Head is in rad. Numbers are read
+ * with std::from_chars, no locale and no copies of the text.
+ *
+ * @throws std::runtime_error on a missing column or a bad value, with its
+ * line number.
+ */
+inline std::vector<FlightRecord> parse_flight_log(std::string_view text) {
+    static constexpr std::array<std::string_view, 12> NAMES = {
+        "wind",     "Lat_drop",  "Long_drop", "H",    "Head",   "Vel",
+        "V_down",   "Lat_land",  "Long_land", "mass", "t_open", "t_land"};
+    std::array<int, NAMES.size()> col;
+    col.fill(-1);
+
+    std::vector<FlightRecord> log;
+    size_t line_no = 0, pos = 0;
+    bool header = true;
+    while (pos < text.size()) {
+        size_t eol = text.find('\n', pos);
+        if (eol == std::string_view::npos) eol = text.size();
+        std::string_view line = text.substr(pos, eol - pos);
+        pos = eol + 1;
+        line_no++;
+
+        size_t p = 0;
+        if (flight_log::next_token(line, p).empty()) continue;  // Blank
+        p = 0;
+        if (header) {
+            int c = 0;
+            for (auto tok = flight_log::next_token(line, p); !tok.empty();
+                 tok = flight_log::next_token(line, p), c++) {
+                for (size_t k = 0; k < NAMES.size(); k++) {
+                    if (tok == NAMES[k]) col[k] = c;
+                }
+            }
+            for (size_t k = 0; k < NAMES.size(); k++) {
+                if (col[k] < 0) {
+                    throw std::runtime_error("Flight log: no column " +
+                                             std::string(NAMES[k]));
+                }
+            }
+            header = false;
+            continue;
+        }
+
+        std::array<std::string_view, NAMES.size()> tok;
+        int c = 0;
+        for (auto t = flight_log::next_token(line, p); !t.empty();
+             t = flight_log::next_token(line, p), c++) {
+            for (size_t k = 0; k < NAMES.size(); k++) {
+                if (col[k] == c) tok[k] = t;
+            }
+        }
+        FlightRecord r;
+        double* fields[] = {&r.drop.lat, &r.drop.lon, &r.h,        &r.head,
+                            &r.vel,      &r.v_down,   &r.land.lat, &r.land.lon,
+                            &r.mass,     &r.t_open,   &r.t_land};
+        bool ok = flight_log::parse_metar(tok[0], r.wind_dir, r.wind_speed);
+        for (size_t k = 1; k < NAMES.size() && ok; k++) {
+            ok = flight_log::parse_double(tok[k], *fields[k - 1]);
+        }
+        if (!ok) {
+            throw std::runtime_error("Flight log: bad value at line " +
+                                     std::to_string(line_no));
+        }
+        log.push_back(r);
+    }
+    return log;
+}
+
+// Same, from a file
+inline std::vector<FlightRecord> read_flight_log(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) throw std::runtime_error("Cannot open flight log " + path);
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    const std::string text = ss.str();
+    return parse_flight_log(text);
+}
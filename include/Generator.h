@@ -0,0 +1,105 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <iterator>
+#include <optional>
+#include <utility>
+
+/**
+ * @brief Lazy sequence produced by a coroutine with co_yield.
+ *
+ * Minimal stand-in for C++23 std::generator. The coroutine runs only when the
+ * next value is requested, and destroying the generator destroys the
+ * coroutine frame, so a consumer can stop the producer at any time.
+ *
+ * @tparam T Type of the yielded values, stored by copy.
+ */
+template <typename T>
+class Generator {
+   public:
+    struct promise_type {
+        std::optional<T> current;
+        std::exception_ptr exception;
+
+        Generator get_return_object() {
+            return Generator{
+                std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        std::suspend_always yield_value(T value) {
+            current = std::move(value);
+            return {};
+        }
+        void return_void() {}
+        void unhandled_exception() { exception = std::current_exception(); }
+    };
+
+    class iterator {
+       public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() {}
+        explicit iterator(Generator* gen) : gen(gen) {}
+
+        const T& operator*() const { return gen->value(); }
+        iterator& operator++() {
+            if (!gen->next()) {
+                gen = nullptr;
+            }
+            return *this;
+        }
+        void operator++(int) { ++*this; }
+        bool operator==(std::default_sentinel_t) const { return !gen; }
+
+       private:
+        Generator* gen = nullptr;
+    };
+
+    Generator(Generator&& other) noexcept
+        : handle(std::exchange(other.handle, nullptr)) {}
+    Generator& operator=(Generator&& other) noexcept {
+        if (this != &other) {
+            if (handle) {
+                handle.destroy();
+            }
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+    Generator(const Generator&) = delete;
+    Generator& operator=(const Generator&) = delete;
+    ~Generator() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    // Resumes the coroutine up to the next value, false when it is over
+    bool next() {
+        if (!handle || handle.done()) {
+            return false;
+        }
+        handle.resume();
+        if (handle.promise().exception) {
+            std::rethrow_exception(handle.promise().exception);
+        }
+        return !handle.done();
+    }
+    // Last value yielded, valid after next() returned true
+    const T& value() const { return *handle.promise().current; }
+
+    iterator begin() {
+        iterator it(this);
+        return next() ? it : iterator();
+    }
+    std::default_sentinel_t end() { return {}; }
+
+   private:
+    explicit Generator(std::coroutine_handle<promise_type> h) : handle(h) {}
+
+    std::coroutine_handle<promise_type> handle;
+};
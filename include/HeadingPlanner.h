@@ -0,0 +1,162 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "BallisticModel.h"
+#include "Dispersion.h"
+#include "Simulation.h"
+#include "State.h"
+#include "Waypoint.h"
+
+/**
+ * @brief 1-sigma uncertainty of the drop inputs.
+ */
+struct DropUncertainty {
+    double wind_speed = 0; /**< Wind speed (m/s) */
+    double wind_dir = 0;   /**< Wind direction (rad) */
+    double cds = 0;        /**< Canopy CdS (m^2) */
+    double mass = 0;       /**< Payload mass (kg) */
+    double delay = 0;      /**< Release timing (s) */
+};
+
+/**
+ * @brief Nominal drop conditions shared by all the candidate headings.
+ */
+struct ApproachConditions {
+    double h = 0;          /**< Release altitude (m) */
+    double speed = 0;      /**< Ground speed at release (m/s) */
+    double v_down = 0;     /**< Vertical speed at release (m/s), NED */
+    double mass = 0;       /**< Payload mass (kg) */
+    double cds = 0;        /**< Canopy CdS (m^2) */
+    double wind_speed = 0; /**< Wind speed (m/s) */
+    double wind_dir = 0;   /**< Wind direction (rad), where it blows to */
+    double t_open = 1;     /**< Canopy opening time (s) */
+};
+
+/**
+ * @brief A run-in heading with the release point that hits the target and
+ * the landing spread around it.
+ */
+struct HeadingCandidate {
+    double heading = 0;         /**< Run-in heading (rad), 0 = north */
+    GPS release;                /**< Nominal release point */
+    LandingSpread spread;       /**< Landing spread, relative to the target */
+    std::vector<GPS> waypoints; /**< way_array of the release point */
+};
+
+/**
+ * @brief Perturbed drops of every candidate heading, in the sweep interface
+ * of Simulation::run_parallel_sweep.
+ *
+ * Each heading takes N_RUNS consecutive indices: the nominal drop, then the
+ * drops with wind speed, wind direction, CdS and mass moved by +1 and -1
+ * sigma. Release timing needs no run, it only moves the release along track.
+ */
+struct HeadingSweep {
+    static constexpr size_t N_RUNS = 9;
+
+    std::vector<double> headings;
+    ApproachConditions cond;
+    DropUncertainty unc;
+
+    size_t size() const { return headings.size() * N_RUNS; }
+
+    std::pair<FixedBallisticModel, State<3>> at(size_t idx) const {
+        double head = headings[idx / N_RUNS];
+        size_t k = idx % N_RUNS;
+        double sign = k % 2 ? 1 : -1;  // Odd runs +1 sigma, even runs -1
+        double ws = cond.wind_speed, wd = cond.wind_dir;
+        double cds = cond.cds, mass = cond.mass;
+        switch ((k + 1) / 2) {
+            case 1:
+                ws += sign * unc.wind_speed;
+                break;
+            case 2:
+                wd += sign * unc.wind_dir;
+                break;
+            case 3:
+                cds += sign * unc.cds;
+                break;
+            case 4:
+                mass += sign * unc.mass;
+                break;
+        }
+        State<3> S0{0,
+                    0,
+                    -cond.h,
+                    cond.speed * cos(head),
+                    cond.speed * sin(head),
+                    cond.v_down};
+        return {FixedBallisticModel(mass, cds,
+                                    VReal3{ws * cos(wd), ws * sin(wd), 0},
+                                    cond.t_open),
+                S0};
+    }
+};
+
+/**
+ * @brief Ranks run-in headings by the landing spread around the target.
+ *
+ * For each of n_headings evenly spaced headings the nominal drop gives the
+ * release point that hits the target. The spread is propagated to first
+ * order with the 1-sigma central differences of HeadingSweep, C = sum_k
+ * d_k d_k^T with d_k = (L(+sigma_k) - L(-sigma_k)) / 2, plus the along track
+ * shift of the release timing. The mean is the nominal landing, i.e. the
+ * target. All the drops run in one parallel sweep.
+ *
+ * @param sim Simulation settings (integrator, dt, T).
+ * @param target Ground target.
+ * @param cond Nominal drop conditions.
+ * @param unc 1-sigma uncertainty of the inputs.
+ * @param n_headings Candidate headings over 360 degrees.
+ * @param way_d Distance of the first and last waypoint from the release (m).
+ * @return The candidates, lowest rms spread first.
+ */
+inline std::vector<HeadingCandidate> rank_headings(
+    Simulation& sim, const GPS& target, const ApproachConditions& cond,
+    const DropUncertainty& unc, size_t n_headings = 36, double way_d = 100) {
+    if (n_headings == 0) {
+        throw std::invalid_argument("n_headings must be nonzero positive");
+    }
+    HeadingSweep sweep{{}, cond, unc};
+    for (size_t i = 0; i < n_headings; i++) {
+        sweep.headings.push_back(2 * M_PI * double(i) / double(n_headings));
+    }
+    std::vector<State<3>> last = sim.run_parallel_sweep(sweep);
+
+    std::vector<double> north(n_headings), east(n_headings);
+    std::vector<HeadingCandidate> cand(n_headings);
+    for (size_t i = 0; i < n_headings; i++) {
+        const State<3>* L = &last[i * HeadingSweep::N_RUNS];
+        HeadingCandidate& c = cand[i];
+        c.heading = sweep.headings[i];
+        north[i] = L[0].X()[0];
+        east[i] = L[0].X()[1];
+        for (size_t k = 1; k < HeadingSweep::N_RUNS; k += 2) {
+            c.spread.add(1, 0.5 * (L[k].X()[0] - L[k + 1].X()[0]),
+                         0.5 * (L[k].X()[1] - L[k + 1].X()[1]));
+        }
+        double shift = cond.speed * unc.delay;
+        c.spread.add(1, shift * cos(c.heading), shift * sin(c.heading));
+    }
+
+    // Release points: the target moved back by the nominal landing offsets
+    std::vector<double> lat(n_headings), lon(n_headings);
+    get_drop_batch(GeoFrame(target), north.data(), east.data(), n_headings,
+                   lat.data(), lon.data());
+    for (size_t i = 0; i < n_headings; i++) {
+        cand[i].release = {lat[i], lon[i]};
+        cand[i].waypoints = way_array(cand[i].release, cand[i].heading, way_d);
+    }
+
+    std::stable_sort(cand.begin(), cand.end(),
+                     [](const HeadingCandidate& a, const HeadingCandidate& b) {
+                         return a.spread.rms() < b.spread.rms();
+                     });
+    return cand;
+}
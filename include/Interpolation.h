@@ -0,0 +1,187 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <span>
+
+#include "State.h"
+
+/**
+ * @brief Cubic Hermite interpolation between two integrated states.
+ *
+ * @param S0 State at the start of the step.
+ * @param F0 Derivative of the state at S0.
+ * @param S1 State at the end of the step.
+ * @param F1 Derivative of the state at S1.
+ * @param theta Position in the step, 0 at S0 and 1 at S1.
+ * @return The interpolated state, with its time set.
+ */
+template <size_t N>
+State<N> hermite(const State<N>& S0, const State<N>& F0, const State<N>& S1,
+                 const State<N>& F1, double theta) {
+    double dt = S1.get_t() - S0.get_t();
+    double th2 = theta * theta;
+    double th3 = th2 * theta;
+    double h00 = 2 * th3 - 3 * th2 + 1;
+    double h10 = th3 - 2 * th2 + theta;
+    double h01 = -2 * th3 + 3 * th2;
+    double h11 = th3 - th2;
+
+    State<N> out;
+    for (size_t i = 0; i < 2 * N; i++) {
+        out[i] = h00 * S0[i] + h10 * dt * F0[i] + h01 * S1[i] + h11 * dt * F1[i];
+    }
+    out(S0.get_t() + theta * dt);
+    return out;
+}
+
+/**
+ * @brief Derivative of a step built from the states only.
+ *
+ * Positions use the velocities stored in the states, velocities use the
+ * secant of the step, so hermite() is cubic in position and linear in
+ * velocity. Used when no derivative was stored with the trajectory.
+ */
+template <size_t N>
+State<N> secant_derivative(const State<N>& S0, const State<N>& S1,
+                           const State<N>& S) {
+    double dt = S1.get_t() - S0.get_t();
+    State<N> F;
+    for (size_t i = 0; i < N; i++) {
+        F[i] = S[N + i];
+        F[N + i] = dt > 0 ? (S1[N + i] - S0[N + i]) / dt : 0;
+    }
+    return F;
+}
+
+/**
+ * @brief State of a step at which component i of hermite() reaches value.
+ *
+ * Bisection on theta, component i must increase over the step and bracket
+ * value, e.g. z across an altitude level during the descent.
+ */
+template <size_t N>
+State<N> hermite_crossing(const State<N>& S0, const State<N>& F0,
+                          const State<N>& S1, const State<N>& F1, size_t i,
+                          double value) {
+    double lo = 0, hi = 1;
+    for (int k = 0; k < 50; k++) {
+        double mid = 0.5 * (lo + hi);
+        if (hermite(S0, F0, S1, F1, mid)[i] < value) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return hermite(S0, F0, S1, F1, 0.5 * (lo + hi));
+}
+
+/**
+ * @brief Queries of a trajectory at arbitrary times or altitudes.
+ *
+ * Wraps the states of a trajectory and, optionally, their derivatives. The
+ * step is found by binary search and interpolated with hermite(), so each
+ * query costs O(log n).
+ */
+template <size_t N>
+class DenseTrajectory {
+   public:
+    DenseTrajectory(std::span<const State<N>> states,
+                    std::span<const State<N>> derivs = {})
+        : states(states), derivs(derivs) {}
+
+    // State at time t, clamped to the time span of the trajectory
+    State<N> at_time(double t) const {
+        if (states.empty()) {
+            throw std::runtime_error("Empty trajectory");
+        }
+        if (t <= states.front().get_t()) {
+            return states.front();
+        }
+        if (t >= states.back().get_t()) {
+            return states.back();
+        }
+        auto it = std::upper_bound(
+            states.begin(), states.end(), t,
+            [](double t, const State<N>& S) { return t < S.get_t(); });
+        size_t i = it - states.begin() - 1;
+        double dt = states[i + 1].get_t() - states[i].get_t();
+        return interpolate(i, dt > 0 ? (t - states[i].get_t()) / dt : 0);
+    }
+
+    /**
+     * @brief State at which the trajectory crosses altitude h (-z).
+     *
+     * The altitude is assumed to decrease along the trajectory, which holds
+     * once the payload is falling. Returns false if h is outside the
+     * altitude span of the trajectory.
+     *
+     * The simulations stop at the last step above the ground, so the span
+     * ends slightly above h = 0. Between the last state and the ground the
+     * crossing is extrapolated at the last velocity, if it falls within one
+     * more step, i.e. the payload landed rather than running out of time.
+     */
+    bool at_altitude(double h, State<N>& S) const {
+        if (states.empty()) {
+            return false;
+        }
+        double z = -h;
+        if (z < states.front().X()[2]) {
+            return false;
+        }
+        if (z > states.back().X()[2]) {
+            return ground_extrapolation(z, S);
+        }
+        auto it = std::lower_bound(
+            states.begin(), states.end(), z,
+            [](const State<N>& S, double z) { return S.X()[2] < z; });
+        if (it == states.begin()) {
+            S = states.front();
+            return true;
+        }
+        size_t i = it - states.begin() - 1;
+        State<N> F0, F1;
+        step_derivatives(i, F0, F1);
+        S = hermite_crossing(states[i], F0, states[i + 1], F1, 2, z);
+        return true;
+    }
+
+   private:
+    bool ground_extrapolation(double z, State<N>& S) const {
+        const State<N>& last = states.back();
+        double vd = last.X_dot()[2];
+        if (z > 0 || states.size() < 2 || vd <= 0) {
+            return false;
+        }
+        double t = (z - last.X()[2]) / vd;
+        if (t > last.get_t() - states[states.size() - 2].get_t()) {
+            return false;
+        }
+        S = last;
+        for (size_t k = 0; k < N; k++) {
+            S[k] += S[N + k] * t;
+        }
+        S(last.get_t() + t);
+        return true;
+    }
+
+    void step_derivatives(size_t i, State<N>& F0, State<N>& F1) const {
+        if (derivs.size() == states.size()) {
+            F0 = derivs[i];
+            F1 = derivs[i + 1];
+        } else {
+            F0 = secant_derivative(states[i], states[i + 1], states[i]);
+            F1 = secant_derivative(states[i], states[i + 1], states[i + 1]);
+        }
+    }
+
+    State<N> interpolate(size_t i, double theta) const {
+        State<N> F0, F1;
+        step_derivatives(i, F0, F1);
+        return hermite(states[i], F0, states[i + 1], F1, theta);
+    }
+
+    std::span<const State<N>> states;
+    std::span<const State<N>> derivs;
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief Latencies of the last events (requests, solutions), for
+ * percentiles.
+ *
+ * Samples are kept in a ring of fixed size, so the percentiles refer to the
+ * most recent events and recording never allocates.
+ */
+class LatencyStats {
+   public:
+    explicit LatencyStats(size_t window = 1 << 16) : samples(window) {}
+
+    void record(double us) {
+        std::lock_guard<std::mutex> lock(mutex);
+        samples[count % samples.size()] = us;
+        count++;
+    }
+
+    // p in [0, 1], 0 if nothing was recorded
+    double percentile(double p) const {
+        std::vector<double> v;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            v.assign(samples.begin(),
+                     samples.begin() + std::min<size_t>(count, samples.size()));
+        }
+        if (v.empty()) return 0;
+        size_t k = std::min(v.size() - 1, size_t(p * double(v.size())));
+        std::nth_element(v.begin(), v.begin() + k, v.end());
+        return v[k];
+    }
+
+    uint64_t size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return count;
+    }
+
+   private:
+    mutable std::mutex mutex;
+    std::vector<double> samples;
+    uint64_t count = 0;
+};
@@ -0,0 +1,310 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+#include "BallisticModel.h"
+#include "LatencyStats.h"
+#include "SharedSolution.h"
+#include "Simulation.h"
+#include "State.h"
+#include "Unscented.h"
+#include "Waypoint.h"
+
+/**
+ * @brief Lock free ring buffer, one producer thread and one consumer
+ * thread.
+ *
+ * Each side owns its index and keeps a cached copy of the other one, so the
+ * shared cache lines are only touched when the ring looks full (producer)
+ * or empty (consumer).
+ */
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                  "Capacity must be a power of 2");
+    static_assert(std::is_trivially_copyable_v<T>);
+
+   public:
+    // Producer side, false if the ring is full
+    bool push(const T& value) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail_cache == Capacity) {
+            tail_cache = tail.load(std::memory_order_acquire);
+            if (h - tail_cache == Capacity) return false;
+        }
+        buf[h & (Capacity - 1)] = value;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side, false if the ring is empty
+    bool pop(T& value) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t == head_cache) {
+            head_cache = head.load(std::memory_order_acquire);
+            if (t == head_cache) return false;
+        }
+        value = buf[t & (Capacity - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+   private:
+    alignas(64) std::atomic<size_t> head{0};  // Next slot to write
+    size_t tail_cache = 0;                    // Producer copy of tail
+    alignas(64) std::atomic<size_t> tail{0};  // Next slot to read
+    size_t head_cache = 0;                    // Consumer copy of head
+    alignas(64) std::array<T, Capacity> buf;
+};
+
+/**
+ * @brief One telemetry sample of the UAV.
+ */
+struct Telemetry {
+    double stamp = 0;            /**< Time of the sample (s), any clock */
+    double lat = 0, lon = 0;     /**< Position of the UAV */
+    double h = 0;                /**< Altitude above the target (m) */
+    double vel_n = 0, vel_e = 0; /**< Ground velocity (m/s) */
+    double vel_d = 0;            /**< Vertical velocity (m/s), NED */
+    double wind_n = 0, wind_e = 0; /**< Wind estimate (m/s) */
+    int64_t t_push = 0; /**< steady_clock ns, set by Predictor::push */
+};
+
+/**
+ * @brief Settings of the Predictor.
+ */
+struct PredictorConfig {
+    GPS target;              /**< Ground target */
+    double mass = 1;         /**< Payload mass (kg) */
+    double cds = 0.3;        /**< Canopy CdS (m^2) */
+    double t_open = 1;       /**< Canopy opening time (s) */
+    double rate_hz = 20;     /**< Solutions per second */
+    double dt = 0.01;        /**< Time step (s) */
+    double T = 60;           /**< Max time of the simulation (s) */
+    std::string method = "rk4";
+    double way_d = 100;      /**< Distance of the first and last waypoint (m) */
+    /** Inputs closer than this to the last solved ones reuse its landing
+     * (m, m/s), 0 = always integrate */
+    double reuse_tol = 0.01;
+    /** 1-sigma of the DropDistribution inputs, for the landing ellipse.
+     * All zero = no ellipse, 15 more runs per solution otherwise */
+    DropDistribution::Vector sigma{};
+    std::string shm_name;    /**< Shared memory to publish to, "" = none */
+};
+
+/**
+ * @brief Counters of the Predictor.
+ */
+struct PredictorStats {
+    uint64_t solutions = 0; /**< Solutions published */
+    uint64_t reused = 0;    /**< Of which without integration */
+    uint64_t missed = 0;    /**< Cycles that ended after their deadline */
+    uint64_t dropped = 0;   /**< Samples refused, ring full */
+    uint64_t skipped = 0;   /**< Samples superseded before being solved */
+    double p50_us = 0;      /**< Telemetry to solution latency (us) */
+    double p99_us = 0;
+    double max_us = 0;
+};
+
+/**
+ * @brief Real-time drop point predictor.
+ *
+ * A thread wakes up rate_hz times per second, drains the telemetry ring
+ * keeping the newest sample and solves the drop point for it: a single
+ * endpoint-only run on its own thread, then the release point, the way_array
+ * waypoints and the time to release. The solution is available from
+ * latest() and, with shm_name set, in shared memory for other processes.
+ *
+ * The solve is warm started from the previous one: when the inputs moved
+ * less than reuse_tol the previous landing is reused, otherwise the
+ * integration horizon is 1.5 times the previous fall time, with a full
+ * horizon rerun if the payload did not land. Latency is measured from
+ * push() to publication; a cycle whose solution is ready after the next
+ * tick counts as a missed deadline and the schedule restarts from there.
+ */
+class Predictor {
+   public:
+    static constexpr size_t RING_SIZE = 256;
+
+    explicit Predictor(const PredictorConfig& cfg) : cfg(cfg) {
+        if (cfg.rate_hz <= 0) {
+            throw std::invalid_argument("rate_hz must be nonzero positive");
+        }
+        Simulation check(cfg.dt, cfg.T, cfg.method);  // Throws if invalid
+        if (!cfg.shm_name.empty()) {
+            publisher = std::make_unique<SolutionPublisher>(cfg.shm_name);
+        }
+        worker = std::thread(&Predictor::loop, this);
+    }
+
+    Predictor(const Predictor&) = delete;
+    Predictor& operator=(const Predictor&) = delete;
+
+    ~Predictor() {
+        stopping.store(true);
+        if (worker.joinable()) worker.join();
+    }
+
+    /**
+     * @brief Queues a sample, from a single producer thread.
+     *
+     * @return false if the ring is full and the sample was dropped.
+     */
+    bool push(Telemetry sample) {
+        sample.t_push = now_ns();
+        if (!ring.push(sample)) {
+            n_dropped++;
+            return false;
+        }
+        return true;
+    }
+
+    // Latest solution, false if none yet
+    bool latest(DropSolution& sol) const { return local.load(sol); }
+
+    PredictorStats stats() const {
+        PredictorStats st;
+        st.solutions = latency.size();
+        st.reused = n_reused.load();
+        st.missed = n_missed.load();
+        st.dropped = n_dropped.load();
+        st.skipped = n_skipped.load();
+        st.p50_us = latency.percentile(0.50);
+        st.p99_us = latency.percentile(0.99);
+        st.max_us = max_us.load();
+        return st;
+    }
+
+   private:
+    static int64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    void loop() {
+        using clock = std::chrono::steady_clock;
+        const auto period = std::chrono::duration_cast<clock::duration>(
+            std::chrono::duration<double>(1 / cfg.rate_hz));
+        auto next = clock::now();
+        while (!stopping.load()) {
+            next += period;
+            Telemetry sample;
+            size_t n = 0;
+            while (ring.pop(sample)) n++;
+            if (n > 0) {
+                n_skipped += n - 1;
+                solve(sample);
+                double us = (now_ns() - sample.t_push) / 1e3;
+                latency.record(us);
+                if (us > max_us.load()) max_us.store(us);
+            }
+            auto now = clock::now();
+            if (now > next) {
+                n_missed++;
+                next = now;  // Restart the schedule, no burst to catch up
+            }
+            std::this_thread::sleep_until(next);
+        }
+    }
+
+    void solve(const Telemetry& s) {
+        double tol = cfg.reuse_tol;
+        bool reuse = has_last && tol > 0 && std::abs(s.h - last.h) < tol &&
+                     std::abs(s.vel_n - last.vel_n) < tol &&
+                     std::abs(s.vel_e - last.vel_e) < tol &&
+                     std::abs(s.vel_d - last.vel_d) < tol &&
+                     std::abs(s.wind_n - last.wind_n) < tol &&
+                     std::abs(s.wind_e - last.wind_e) < tol;
+        if (reuse) {
+            n_reused++;
+        } else {
+            FixedBallisticModel bm(cfg.mass, cfg.cds,
+                                   VReal3{s.wind_n, s.wind_e, 0}, cfg.t_open);
+            State<3> S0{0, 0, -s.h, s.vel_n, s.vel_e, s.vel_d};
+            double T = has_last ? std::min(cfg.T, 1.5 * t_fall + 10 * cfg.dt)
+                                : cfg.T;
+            State<3> S_end = Simulation(cfg.dt, T, cfg.method).run_last(bm, S0);
+            if (T < cfg.T && S_end.get_t() + cfg.dt >= T) {
+                // Still in the air, the warm start was too short
+                S_end = Simulation(cfg.dt, cfg.T, cfg.method).run_last(bm, S0);
+            }
+            north = S_end.X()[0];
+            east = S_end.X()[1];
+            t_fall = S_end.get_t();
+            spread = ellipse(s);
+            last = s;
+            has_last = true;
+        }
+
+        DropSolution sol;
+        sol.stamp = s.stamp;
+        get_drop_batch(GeoFrame(cfg.target), &north, &east, 1, &sol.drop_lat,
+                       &sol.drop_lon);
+        double heading = std::atan2(s.vel_e, s.vel_n);
+        way_array_batch(&sol.drop_lat, &sol.drop_lon, &heading, 1,
+                        cfg.way_d, sol.waypoints);
+        // Along track distance to the release point over the ground speed
+        double dn, de;
+        GeoFrame(GPS{s.lat, s.lon}).to_enu(&sol.drop_lat, &sol.drop_lon, 1,
+                                           &dn, &de);
+        double v2 = s.vel_n * s.vel_n + s.vel_e * s.vel_e;
+        sol.time_to_release = v2 > 0 ? (dn * s.vel_n + de * s.vel_e) / v2 : 0;
+        sol.spread = spread;
+
+        local.store(sol);
+        if (publisher) publisher->publish(sol);
+    }
+
+    // Landing ellipse around the target by the unscented transform
+    LandingSpread ellipse(const Telemetry& s) const {
+        LandingSpread sp;
+        bool any = false;
+        for (double v : cfg.sigma) any = any || v > 0;
+        if (!any) return sp;
+
+        using D = DropDistribution;
+        D dist;
+        dist.h = s.h;
+        dist.t_open = cfg.t_open;
+        dist.mean = {s.wind_n, s.wind_e, cfg.cds,  cfg.mass,
+                     s.vel_n,  s.vel_e,  s.vel_d};
+        for (size_t k = 0; k < D::N_INPUTS; k++) {
+            dist.cov[k][k] = cfg.sigma[k] * cfg.sigma[k];
+        }
+        // The autopilot waits on it, ahead of any background sweep
+        Simulation sim(cfg.dt, cfg.T, cfg.method);
+        sim.set_priority(Priority::LIVE);
+        sp = unscented_landing(sim, dist);
+        sp.n -= north;  // The release point puts the nominal on the target
+        sp.e -= east;
+        return sp;
+    }
+
+    PredictorConfig cfg;
+    SpscRing<Telemetry, RING_SIZE> ring;
+    SolutionBlock local{};  // Same seqlock as the shared memory
+    std::unique_ptr<SolutionPublisher> publisher;
+
+    // Warm start, touched by the worker only
+    Telemetry last;
+    bool has_last = false;
+    double north = 0, east = 0, t_fall = 0;
+    LandingSpread spread;
+
+    LatencyStats latency;
+    std::atomic<uint64_t> n_reused{0}, n_missed{0}, n_dropped{0},
+        n_skipped{0};
+    std::atomic<double> max_us{0};
+    std::atomic<bool> stopping{false};
+    std::thread worker;  // Last, started once everything else is built
+};
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+/**
+ * @brief Binary protocol of the drop server, over a Unix domain socket.
+ *
+ * Both ends run on the same host, so the structs travel as they are in
+ * memory. A request is a RequestHeader followed by count Launch records, the
+ * reply a ReplyHeader followed by:
+ *  - DROP: count {lat, lon} pairs of the release points.
+ *  - TRAJECTORY: for each launch an uint32 length, then length states
+ *    {N, E, D, Vn, Ve, Vd, t}, as returned by trajectories().
+ *  - STATS: one ServerStats.
+ * A connection carries any number of requests, one at a time.
+ */
+namespace proto {
+
+constexpr uint32_t MAGIC = 0x44544653;  // "SFTD"
+constexpr uint32_t MAX_LAUNCHES = 1 << 16;
+
+enum Type : uint16_t { DROP = 1, TRAJECTORY = 2, STATS = 3 };
+enum Status : uint16_t { OK = 0, BAD_REQUEST = 1, FAILED = 2 };
+
+struct RequestHeader {
+    uint32_t magic = MAGIC;
+    uint16_t type = DROP;
+    uint16_t reserved = 0;
+    uint32_t id = 0;      /**< Echoed in the reply */
+    uint32_t count = 0;   /**< Num of Launch records that follow */
+    double time = 20;     /**< Time of the simulation (s) */
+    double step = 0.01;   /**< Step of the simulation (s) */
+    double tail_tol = 0;  /**< Terminal tail tolerance (m/s2), 0 = off */
+    char method[16] = "rk4";
+};
+
+// Same inputs as dropPoints, the wind already decoded
+struct Launch {
+    double wind_dir;   /**< Wind direction (rad), where it blows to */
+    double wind_speed; /**< Wind speed (m/s) */
+    double vel_head;   /**< Heading of the UAV (rad) */
+    double vel_speed;  /**< Ground speed of the UAV (m/s) */
+    double v_down;     /**< Vertical speed of the UAV (m/s), NED */
+    double h;          /**< Altitude (m) */
+    double mass;       /**< Payload mass (kg) */
+    double cds;        /**< Canopy CdS (m^2) */
+    double lat, lon;   /**< GPS target */
+};
+
+struct ReplyHeader {
+    uint32_t magic = MAGIC;
+    uint16_t type = DROP;
+    uint16_t status = OK;
+    uint32_t id = 0;
+    uint32_t count = 0;
+};
+
+struct ServerStats {
+    uint64_t requests = 0; /**< Requests answered */
+    uint64_t launches = 0; /**< Launches integrated */
+    uint64_t batches = 0;  /**< Batches run */
+    double p50_us = 0;     /**< Median latency, receive to reply (us) */
+    double p99_us = 0;     /**< 99th percentile latency (us) */
+    double throughput = 0; /**< Requests per second since the start */
+};
+
+// Reads exactly n bytes, false on EOF or error
+inline bool read_full(int fd, void* buf, size_t n) {
+    char* p = static_cast<char*>(buf);
+    while (n > 0) {
+        ssize_t r = ::read(fd, p, n);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return false;
+        p += r;
+        n -= size_t(r);
+    }
+    return true;
+}
+
+// Writes exactly n bytes, false on error
+inline bool write_full(int fd, const void* buf, size_t n) {
+    const char* p = static_cast<const char*>(buf);
+    while (n > 0) {
+        ssize_t r = ::send(fd, p, n, MSG_NOSIGNAL);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return false;
+        p += r;
+        n -= size_t(r);
+    }
+    return true;
+}
+
+inline sockaddr_un socket_address(const std::string& path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        throw std::invalid_argument("Socket path too long");
+    }
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return addr;
+}
+
+// Connected client socket, -1 on error
+inline int connect_socket(const std::string& path) {
+    sockaddr_un addr = socket_address(path);
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+}  // namespace proto
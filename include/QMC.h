@@ -0,0 +1,435 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "AnalyticDrop.h"
+#include "BallisticModel.h"
+#include "Simulation.h"
+#include "State.h"
+#include "Unscented.h"
+
+enum class Sampling { MC, SOBOL, HALTON };
+
+// splitmix64 finalizer, turns a counter into a well spread 64 bit value
+inline uint64_t mix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+/**
+ * @brief Points of the unit cube, computed from their index only.
+ *
+ * No state is carried from a point to the next, so any thread or shard can
+ * generate any range of points without coordination, and the same (seed,
+ * index) always gives the same point.
+ *  - MC: counter based pseudo random numbers (splitmix64).
+ *  - SOBOL: Sobol sequence with the Joe-Kuo direction numbers, randomized by
+ *    a digital shift (XOR) drawn from the seed.
+ *  - HALTON: radical inverses in the first primes, randomized by a
+ *    Cranley-Patterson rotation drawn from the seed.
+ * Coordinates are in the open interval (0, 1). Different seeds give
+ * independent randomizations, used to estimate the error of QMC.
+ */
+class PointSet {
+   public:
+    static constexpr size_t MAX_DIM = 16;
+
+    PointSet(Sampling kind, size_t dim, uint64_t seed = 0)
+        : kind(kind), dim(dim), seed(seed) {
+        if (dim == 0 || dim > MAX_DIM) {
+            throw std::invalid_argument("PointSet dimension out of range");
+        }
+        // Joe-Kuo (new-joe-kuo-6.21201) s, a, m_1..m_s of dimensions 2..16
+        static const unsigned s_[MAX_DIM] = {0, 1, 2, 3, 3, 4, 4, 5,
+                                             5, 5, 5, 5, 5, 6, 6, 6};
+        static const unsigned a_[MAX_DIM] = {0, 0, 1,  1,  2,  1,  4, 2,
+                                             4, 7, 11, 13, 14, 1, 13, 16};
+        static const unsigned m_[MAX_DIM][6] = {
+            {0},
+            {1},
+            {1, 3},
+            {1, 3, 1},
+            {1, 1, 1},
+            {1, 1, 3, 3},
+            {1, 3, 5, 13},
+            {1, 1, 5, 5, 17},
+            {1, 1, 5, 5, 5},
+            {1, 1, 7, 11, 19},
+            {1, 1, 5, 1, 1},
+            {1, 1, 1, 3, 11},
+            {1, 3, 5, 5, 31},
+            {1, 3, 3, 9, 7, 49},
+            {1, 1, 1, 15, 21, 21},
+            {1, 3, 1, 13, 27, 49}};
+        for (size_t j = 0; j < MAX_DIM; j++) {
+            unsigned s = s_[j];
+            for (unsigned k = 0; k < 32; k++) {
+                if (j == 0) {
+                    v[j][k] = 1u << (31 - k);
+                } else if (k < s) {
+                    v[j][k] = m_[j][k] << (31 - k);
+                } else {
+                    uint32_t x = v[j][k - s] ^ (v[j][k - s] >> s);
+                    for (unsigned i = 1; i < s; i++) {
+                        if ((a_[j] >> (s - 1 - i)) & 1) {
+                            x ^= v[j][k - i];
+                        }
+                    }
+                    v[j][k] = x;
+                }
+            }
+            uint64_t r = mix64(mix64(seed) + j);
+            shift[j] = uint32_t(r >> 32);
+            rot[j] = double(r >> 11) * 0x1p-53;
+        }
+    }
+
+    // Coordinates of the idx-th point, u must hold dim values
+    void point(uint64_t idx, double* u) const {
+        switch (kind) {
+            case Sampling::MC: {
+                uint64_t base = mix64(seed) ^ (idx * MAX_DIM);
+                for (size_t j = 0; j < dim; j++) {
+                    u[j] = (double(mix64(base + j) >> 11) + 0.5) * 0x1p-53;
+                }
+                break;
+            }
+            case Sampling::SOBOL: {
+                if (idx >> 32) {
+                    throw std::out_of_range("Sobol index beyond 2^32");
+                }
+                for (size_t j = 0; j < dim; j++) {
+                    uint32_t x = shift[j];
+                    for (unsigned k = 0; k < 32; k++) {
+                        if ((idx >> k) & 1) {
+                            x ^= v[j][k];
+                        }
+                    }
+                    u[j] = (double(x) + 0.5) * 0x1p-32;
+                }
+                break;
+            }
+            case Sampling::HALTON: {
+                static const unsigned primes[MAX_DIM] = {
+                    2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53};
+                for (size_t j = 0; j < dim; j++) {
+                    double inv = 1.0 / primes[j], f = inv, x = 0;
+                    for (uint64_t i = idx + 1; i > 0; i /= primes[j]) {
+                        x += f * double(i % primes[j]);
+                        f *= inv;
+                    }
+                    x += rot[j];
+                    x -= std::floor(x);
+                    u[j] = std::min(std::max(x, 0x1p-53), 1 - 0x1p-53);
+                }
+                break;
+            }
+        }
+    }
+
+   private:
+    Sampling kind;
+    size_t dim;
+    uint64_t seed;
+    std::array<std::array<uint32_t, 32>, MAX_DIM> v;  // Direction numbers
+    std::array<uint32_t, MAX_DIM> shift;              // Digital shift
+    std::array<double, MAX_DIM> rot;                  // Rotation
+};
+
+/**
+ * @brief Quantile of the standard normal distribution, Acklam's rational
+ * approximation refined by one Halley step (full double accuracy).
+ */
+inline double normal_quantile(double p) {
+    static const double a[] = {-3.969683028665376e+01, 2.209460984245205e+02,
+                               -2.759285104469687e+02, 1.383577518672690e+02,
+                               -3.066479806614716e+01, 2.506628277459239e+00};
+    static const double b[] = {-5.447609879822406e+01, 1.615858368580409e+02,
+                               -1.556989798598866e+02, 6.680131188771972e+01,
+                               -1.328068155288572e+01};
+    static const double c[] = {-7.784894002430293e-03, -3.223964580411365e-01,
+                               -2.400758277161838e+00, -2.549732539343734e+00,
+                               4.374664141464968e+00,  2.938163982698783e+00};
+    static const double d[] = {7.784695709041462e-03, 3.224671290700398e-01,
+                               2.445134137142996e+00, 3.754408661907416e+00};
+    double x;
+    if (p < 0.02425) {
+        double q = std::sqrt(-2 * std::log(p));
+        x = (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q +
+             c[5]) /
+            ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+    } else if (p > 1 - 0.02425) {
+        double q = std::sqrt(-2 * std::log1p(-p));
+        x = -(((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q +
+              c[5]) /
+            ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+    } else {
+        double q = p - 0.5, r = q * q;
+        x = (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r +
+             a[5]) *
+            q /
+            (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1);
+    }
+    double e = 0.5 * std::erfc(-x / M_SQRT2) - p;
+    double u = e * std::sqrt(2 * M_PI) * std::exp(0.5 * x * x);
+    return x - u / (1 + 0.5 * x * u);
+}
+
+/**
+ * @brief Drops sampled from a DropDistribution by index, in the sweep
+ * interface of Simulation::run_parallel_sweep.
+ *
+ * Index idx maps to point first + idx of the PointSet, or with antithetic
+ * sampling to point first + idx / 2, mirrored (z -> -z) for odd idx.
+ */
+struct DistributionSweep {
+    using Vector = DropDistribution::Vector;
+
+    const DropDistribution& dist;
+    std::array<Vector, DropDistribution::N_INPUTS> L;  // Cholesky of cov
+    PointSet points;
+    size_t first = 0;
+    size_t n = 0;
+    bool antithetic = false;
+
+    DistributionSweep(const DropDistribution& dist, Sampling kind,
+                      uint64_t seed, size_t first, size_t n,
+                      bool antithetic = false)
+        : dist(dist),
+          L(dist.cholesky()),
+          points(kind, DropDistribution::N_INPUTS, seed),
+          first(first),
+          n(n),
+          antithetic(antithetic) {}
+
+    size_t size() const { return n; }
+
+    Vector inputs(size_t idx) const {
+        Vector u, x = dist.mean;
+        points.point(first + (antithetic ? idx / 2 : idx), u.data());
+        double sign = antithetic && idx % 2 ? -1 : 1;
+        for (auto& z : u) {
+            z = sign * normal_quantile(z);
+        }
+        for (size_t i = 0; i < x.size(); i++) {
+            for (size_t j = 0; j <= i; j++) {
+                x[i] += L[i][j] * u[j];
+            }
+        }
+        return x;
+    }
+
+    std::pair<FixedBallisticModel, State<3>> at(size_t idx) const {
+        return dist.drop(inputs(idx));
+    }
+};
+
+struct SamplingOptions {
+    Sampling kind = Sampling::MC;
+    bool antithetic = false;      /**< Mirrored pairs of points */
+    bool control_variate = false; /**< Analytic predictor as control */
+    size_t replicates = 8;        /**< Randomizations of QMC, for the error */
+    size_t cv_factor = 16;        /**< Analytic samples per run for E[C] */
+    uint64_t seed = 0;
+};
+
+/**
+ * @brief Estimate of the mean landing (north, east) and its standard error.
+ */
+struct MeanEstimate {
+    double n = 0, e = 0;       /**< Mean landing (m) */
+    double se_n = 0, se_e = 0; /**< Standard error (m) */
+    size_t runs = 0;           /**< Simulations used */
+};
+
+/**
+ * @brief Mean landing of a DropDistribution with variance reduction.
+ *
+ * The n_runs drops are split in independent units whose spread gives the
+ * standard error: single runs (pairs with antithetic sampling) for MC, whole
+ * randomizations of n_runs / replicates points for QMC. With the control
+ * variate each run Y is paired with the closed form landing C of the same
+ * inputs (AnalyticDrop.h) and the estimate is mean(Y - beta (C - E[C])),
+ * with beta fitted per coordinate and E[C] computed on cv_factor * n_runs
+ * extra analytic drops of the same sampling, whose error is included in the
+ * standard error.
+ *
+ * @param sim Simulation settings (integrator, dt, T).
+ * @param dist Distribution of the inputs.
+ * @param n_runs Number of simulations.
+ * @param opt Sampling and variance reduction.
+ */
+inline MeanEstimate landing_mean(Simulation& sim, const DropDistribution& dist,
+                                 size_t n_runs, const SamplingOptions& opt) {
+    using D = DropDistribution;
+    const bool qmc = opt.kind != Sampling::MC;
+    const size_t n_rep = qmc ? std::max<size_t>(opt.replicates, 2) : 1;
+    const size_t per_rep = n_runs / n_rep;
+    const size_t unit = opt.antithetic ? 2 : 1;
+    if (per_rep < 2 * unit) {
+        throw std::invalid_argument("Too few runs for the error estimate");
+    }
+
+    // Closed form landing of the inputs x
+    auto analytic = [&](const D::Vector& x) {
+        auto [bm, S0] = dist.drop(x);
+        State<3> S = analytic_drop(S0, VReal3{x[D::WIND_N], x[D::WIND_E], 0},
+                                   x[D::CDS], x[D::MASS], dist.t_open,
+                                   sim.get_time_interval());
+        return std::pair<double, double>{S.X()[0], S.X()[1]};
+    };
+
+    // Units (y_n, y_e, c_n, c_e): runs or pairs for MC, replicates for QMC
+    std::vector<std::array<double, 4>> units;
+    for (size_t r = 0; r < n_rep; r++) {
+        DistributionSweep sweep(dist, opt.kind, opt.seed + r, 0, per_rep,
+                                opt.antithetic);
+        std::vector<State<3>> last = sim.run_parallel_sweep(sweep);
+        std::array<double, 4> acc{};
+        for (size_t i = 0; i < per_rep; i++) {
+            std::array<double, 4> y{last[i].X()[0], last[i].X()[1], 0, 0};
+            if (opt.control_variate) {
+                auto [cn, ce] = analytic(sweep.inputs(i));
+                y[2] = cn;
+                y[3] = ce;
+            }
+            for (size_t k = 0; k < 4; k++) {
+                acc[k] += y[k];
+            }
+            if (!qmc && (i + 1) % unit == 0) {
+                for (auto& a : acc) {
+                    a /= unit;
+                }
+                units.push_back(acc);
+                acc = {};
+            }
+        }
+        if (qmc) {
+            for (auto& a : acc) {
+                a /= per_rep;
+            }
+            units.push_back(acc);
+        }
+    }
+    const double m = units.size();
+
+    // Control variate mean, on cv_factor times more independent points of
+    // the same kind, with its error from the spread of the randomizations
+    double ec_n = 0, ec_e = 0, var_ec_n = 0, var_ec_e = 0;
+    if (opt.control_variate) {
+        const size_t n_cv = std::max<size_t>(opt.cv_factor, 1) * per_rep;
+        std::vector<std::pair<double, double>> cv_units;
+        for (size_t r = 0; r < n_rep; r++) {
+            DistributionSweep cv(dist, opt.kind, mix64(opt.seed) + r, 0,
+                                 n_cv);
+            double s_n = 0, s_e = 0;
+            for (size_t i = 0; i < n_cv; i++) {
+                auto [cn, ce] = analytic(cv.inputs(i));
+                if (qmc) {
+                    s_n += cn / n_cv;
+                    s_e += ce / n_cv;
+                } else {
+                    cv_units.push_back({cn, ce});
+                }
+            }
+            if (qmc) {
+                cv_units.push_back({s_n, s_e});
+            }
+        }
+        const double mu = cv_units.size();
+        for (const auto& [cn, ce] : cv_units) {
+            ec_n += cn / mu;
+            ec_e += ce / mu;
+        }
+        for (const auto& [cn, ce] : cv_units) {
+            var_ec_n += (cn - ec_n) * (cn - ec_n) / ((mu - 1) * mu);
+            var_ec_e += (ce - ec_e) * (ce - ec_e) / ((mu - 1) * mu);
+        }
+    }
+
+    MeanEstimate est;
+    est.runs = n_rep * per_rep;
+    for (size_t k = 0; k < 2; k++) {
+        double my = 0, mc = 0;
+        for (const auto& u : units) {
+            my += u[k] / m;
+            mc += u[k + 2] / m;
+        }
+        double beta = 0;
+        if (opt.control_variate) {
+            double cyc = 0, cc = 0;
+            for (const auto& u : units) {
+                cyc += (u[k] - my) * (u[k + 2] - mc);
+                cc += (u[k + 2] - mc) * (u[k + 2] - mc);
+            }
+            beta = cc > 0 ? cyc / cc : 0;
+        }
+        double ec = k == 0 ? ec_n : ec_e;
+        double mean = my - beta * (mc - ec);
+        double var = 0;
+        for (const auto& u : units) {
+            double r = u[k] - beta * (u[k + 2] - mc) - my;
+            var += r * r / (m - 1);
+        }
+        double se = std::sqrt(var / m +
+                              beta * beta * (k == 0 ? var_ec_n : var_ec_e));
+        (k == 0 ? est.n : est.e) = mean;
+        (k == 0 ? est.se_n : est.se_e) = se;
+    }
+    return est;
+}
+
+/**
+ * @brief One point of a convergence curve.
+ */
+struct ConvergencePoint {
+    std::string method;
+    MeanEstimate est;
+};
+
+/**
+ * @brief Convergence of the mean landing for plain MC and the variance
+ * reduced samplers, at n_min, 2 n_min, ..., n_max runs.
+ *
+ * Methods: "mc", "mc+antithetic", "mc+cv", "halton", "sobol", "sobol+cv".
+ * The standard error of each point gives the curve, e.g. to read the runs
+ * each method needs for a given confidence interval width.
+ */
+inline std::vector<ConvergencePoint> landing_convergence(
+    Simulation& sim, const DropDistribution& dist, size_t n_min, size_t n_max,
+    uint64_t seed = 0) {
+    struct Method {
+        const char* name;
+        Sampling kind;
+        bool antithetic, cv;
+    };
+    static const Method methods[] = {
+        {"mc", Sampling::MC, false, false},
+        {"mc+antithetic", Sampling::MC, true, false},
+        {"mc+cv", Sampling::MC, false, true},
+        {"halton", Sampling::HALTON, false, false},
+        {"sobol", Sampling::SOBOL, false, false},
+        {"sobol+cv", Sampling::SOBOL, false, true}};
+
+    std::vector<ConvergencePoint> curve;
+    for (size_t n = std::max<size_t>(n_min, 32); n <= n_max; n *= 2) {
+        for (const Method& mt : methods) {
+            SamplingOptions opt;
+            opt.kind = mt.kind;
+            opt.antithetic = mt.antithetic;
+            opt.control_variate = mt.cv;
+            opt.seed = seed;
+            curve.push_back({mt.name, landing_mean(sim, dist, n, opt)});
+        }
+    }
+    return curve;
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "AnalyticDrop.h"
+#include "BallisticModel.h"
+#include "FlightLog.h"
+#include "Simulation.h"
+#include "State.h"
+
+/**
+ * @brief Flights of a log, in the sweep interface of
+ * Simulation::run_parallel_sweep.
+ */
+struct FlightSweep {
+    const std::vector<FlightRecord>& log;
+    double cds;
+
+    size_t size() const { return log.size(); }
+
+    std::pair<FixedBallisticModel, State<3>> at(size_t idx) const {
+        const FlightRecord& r = log[idx];
+        return {FixedBallisticModel(r.mass, cds, r.wind(), r.t_open),
+                r.release()};
+    }
+};
+
+/**
+ * @brief Accuracy and cost of one method/dt setting over a flight log.
+ */
+struct ReplayStats {
+    std::string method;
+    double dt = 0;          /**< Time step (s), 0 for analytic */
+    size_t flights = 0;
+    size_t landed = 0;      /**< Flights that landed within T */
+    double mean_err = 0;    /**< Landing error against the log (m) */
+    double rms_err = 0;
+    double p50_err = 0;
+    double p95_err = 0;
+    double max_err = 0;
+    double ref_rms = 0;     /**< RMS distance from the reference landings (m) */
+    double wall_us = 0;     /**< Time of one replay of the log */
+    double runs_per_s = 0;
+};
+
+/**
+ * @brief Model landings (north, east) of every flight of the log.
+ *
+ * @param method Integrator of Simulation, or "analytic" for analytic_drop.
+ * @param wall_us Time of one replay, the best of repeat.
+ */
+inline std::vector<std::pair<double, double>> replay_landings(
+    const std::vector<FlightRecord>& log, double cds, const std::string& method,
+    double dt, double T, size_t repeat, double& wall_us,
+    std::vector<bool>* landed = nullptr) {
+    using clock = std::chrono::steady_clock;
+    std::vector<std::pair<double, double>> out(log.size());
+    if (landed) landed->assign(log.size(), true);
+    wall_us = 0;
+    for (size_t k = 0; k < std::max<size_t>(repeat, 1); k++) {
+        auto t0 = clock::now();
+        if (method == "analytic") {
+            for (size_t i = 0; i < log.size(); i++) {
+                const FlightRecord& r = log[i];
+                State<3> S = analytic_drop(r.release(), r.wind(), cds, r.mass,
+                                           r.t_open, T);
+                out[i] = {S.X()[0], S.X()[1]};
+                if (landed) (*landed)[i] = S.get_t() < T;
+            }
+        } else {
+            Simulation sim(dt, T, method);
+            std::vector<State<3>> last =
+                sim.run_parallel_sweep(FlightSweep{log, cds}, 4);
+            for (size_t i = 0; i < log.size(); i++) {
+                out[i] = {last[i].X()[0], last[i].X()[1]};
+                if (landed) (*landed)[i] = last[i].get_t() + dt < T;
+            }
+        }
+        double us = std::chrono::duration<double, std::micro>(clock::now() - t0)
+                        .count();
+        wall_us = k == 0 ? us : std::min(wall_us, us);
+    }
+    return out;
+}
+
+/**
+ * @brief Replays a flight log with one method/dt setting.
+ *
+ * The flights run in parallel on the shared Executor. The errors are the
+ * distances of the model landing from the logged one; ref_rms compares
+ * with the given reference landings instead (e.g. a much smaller step),
+ * i.e. the part of the error due to the integration alone.
+ *
+ * @param log The flights.
+ * @param cds Calibrated canopy CdS (m^2).
+ * @param method Integrator of Simulation, or "analytic".
+ * @param dt Time step (s).
+ * @param T Max time of the simulation (s).
+ * @param repeat Replays timed, the best one is kept.
+ * @param ref Reference landings, empty for none.
+ */
+inline ReplayStats replay(const std::vector<FlightRecord>& log, double cds,
+                          const std::string& method, double dt, double T,
+                          size_t repeat = 1,
+                          const std::vector<std::pair<double, double>>& ref =
+                              {}) {
+    ReplayStats st;
+    st.method = method;
+    st.dt = method == "analytic" ? 0 : dt;
+    st.flights = log.size();
+    std::vector<bool> landed;
+    auto land = replay_landings(log, cds, method, dt, T, repeat, st.wall_us,
+                                &landed);
+    st.runs_per_s = st.wall_us > 0 ? log.size() / (st.wall_us * 1e-6) : 0;
+
+    std::vector<double> err;
+    double ref2 = 0;
+    for (size_t i = 0; i < log.size(); i++) {
+        if (!landed[i]) continue;
+        auto [n, e] = log[i].landing();
+        err.push_back(std::hypot(land[i].first - n, land[i].second - e));
+        if (!ref.empty()) {
+            ref2 += std::pow(land[i].first - ref[i].first, 2) +
+                    std::pow(land[i].second - ref[i].second, 2);
+        }
+    }
+    st.landed = err.size();
+    if (err.empty()) return st;
+    for (double x : err) {
+        st.mean_err += x / err.size();
+        st.rms_err += x * x / err.size();
+    }
+    st.rms_err = std::sqrt(st.rms_err);
+    st.ref_rms = std::sqrt(ref2 / err.size());
+    std::sort(err.begin(), err.end());
+    auto pct = [&](double p) {
+        return err[std::min(err.size() - 1, size_t(p * err.size()))];
+    };
+    st.p50_err = pct(0.50);
+    st.p95_err = pct(0.95);
+    st.max_err = err.back();
+    return st;
+}
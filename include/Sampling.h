@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "State.h"
+
+/**
+ * @brief Events at which a sampled run records the state.
+ *
+ * Each altitude level is recorded at its first crossing during the descent,
+ * each time mark when the integration passes it, and the last state (impact
+ * or end of the time interval) is always recorded. A run therefore stores
+ * size() states, whatever its length.
+ */
+struct SampleEvents {
+    std::vector<double> altitudes; /**< Altitude levels (m), -z */
+    std::vector<double> times;     /**< Time marks (s) */
+
+    // Altitudes first, then times, then the impact
+    size_t size() const { return altitudes.size() + times.size() + 1; }
+    size_t impactIndex() const { return size() - 1; }
+
+    /**
+     * @brief Altitude levels every dh meters, from top down to dh, e.g. to
+     * get the drift per layer.
+     */
+    static SampleEvents layers(double top, double dh) {
+        if (dh <= 0) {
+            throw std::invalid_argument("layer thickness must be positive");
+        }
+        SampleEvents ev;
+        for (double h = top; h > 0; h -= dh) {
+            ev.altitudes.push_back(h);
+        }
+        return ev;
+    }
+};
+
+/**
+ * @brief Fixed size records of sampled runs.
+ *
+ * The states of all the runs are stored in a single buffer, record i being
+ * the SampleEvents::size() consecutive states of the i-th initial condition.
+ * Events that never happened (altitude above the release, time mark after
+ * the impact) are flagged as missing.
+ */
+template <size_t N>
+class SampledResults {
+    SampleEvents events;
+    std::vector<State<N>> states;
+    std::vector<uint8_t> hit;  // 1 if the event happened
+
+   public:
+    SampledResults() {}
+    SampledResults(const SampleEvents& events, size_t n_ic)
+        : events(events),
+          states(n_ic * events.size()),
+          hit(n_ic * events.size(), 0) {}
+
+    size_t getSSize() const {
+        return events.size() ? states.size() / events.size() : 0;
+    }
+    size_t eventCount() const { return events.size(); }
+    const SampleEvents& getEvents() const { return events; }
+
+    // Record of the i-th initial condition, indexed as the events
+    std::span<const State<N>> operator[](size_t i) const {
+        if (i >= getSSize()) {
+            throw std::out_of_range("Index out of range");
+        }
+        return {states.data() + i * events.size(), events.size()};
+    }
+    bool found(size_t i, size_t k) const {
+        return hit.at(i * events.size() + k);
+    }
+    State<N> getImpact(size_t i) const {
+        return (*this)[i][events.impactIndex()];
+    }
+
+    // Writable record and flags of a run, used by the simulation threads
+    std::span<State<N>> record(size_t i) {
+        return {states.data() + i * events.size(), events.size()};
+    }
+    std::span<uint8_t> flags(size_t i) {
+        return {hit.data() + i * events.size(), events.size()};
+    }
+};
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <array>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "BallisticModel.h"
+#include "QMC.h"
+#include "Simulation.h"
+#include "State.h"
+#include "Unscented.h"
+
+/**
+ * @brief Drops of the Saltelli scheme, in the sweep interface of
+ * Simulation::run_parallel_sweep.
+ *
+ * The rows of the matrices A and B are the first and last k coordinates of
+ * the same 2k dimensional Sobol point, mapped through the DropDistribution.
+ * The indices are laid out in k + 2 blocks of n rows: A, B, then A_B^i (A
+ * with column i taken from B) for i = 0..k-1.
+ */
+struct SaltelliSweep {
+    static constexpr size_t K = DropDistribution::N_INPUTS;
+    using Vector = DropDistribution::Vector;
+
+    const DropDistribution& dist;
+    std::array<Vector, K> L;  // Cholesky of cov
+    PointSet points;
+    size_t n;
+
+    SaltelliSweep(const DropDistribution& dist, size_t n, uint64_t seed)
+        : dist(dist),
+          L(dist.cholesky()),
+          points(Sampling::SOBOL, 2 * K, seed),
+          n(n) {}
+
+    size_t size() const { return (K + 2) * n; }
+
+    Vector inputs(size_t idx) const {
+        size_t block = idx / n;
+        std::array<double, 2 * K> u;
+        points.point(idx % n, u.data());
+        Vector z;
+        for (size_t i = 0; i < K; i++) {
+            bool from_b = block == 1 || (block >= 2 && block - 2 == i);
+            z[i] = normal_quantile(u[from_b ? K + i : i]);
+        }
+        Vector x = dist.mean;
+        for (size_t i = 0; i < K; i++) {
+            for (size_t j = 0; j <= i; j++) {
+                x[i] += L[i][j] * z[j];
+            }
+        }
+        return x;
+    }
+
+    std::pair<FixedBallisticModel, State<3>> at(size_t idx) const {
+        return dist.drop(inputs(idx));
+    }
+};
+
+/**
+ * @brief First and total order Sobol indices of the landing coordinates.
+ */
+struct SobolIndices {
+    using Vector = DropDistribution::Vector;
+
+    Vector first_n{}, total_n{}; /**< Of the north coordinate */
+    Vector first_e{}, total_e{}; /**< Of the east coordinate */
+    double var_n = 0, var_e = 0; /**< Variance of the coordinates (m^2) */
+    size_t runs = 0;
+};
+
+/**
+ * @brief Sobol indices of the landing point with the Saltelli scheme.
+ *
+ * The (k + 2) n drops of SaltelliSweep run in one parallel sweep with the
+ * endpoint-only integrator. First order indices use the estimator of
+ * Saltelli et al. (2010), S_i = mean(f(B) (f(A_B^i) - f(A))) / V, total
+ * indices the one of Jansen, ST_i = mean((f(A) - f(A_B^i))^2) / 2V, with V
+ * the variance of f over A and B. Inputs are correlated only through the
+ * Cholesky factor, so with a non diagonal covariance the indices refer to
+ * the independent normal factors rather than to the inputs themselves.
+ *
+ * @param sim Simulation settings (integrator, dt, T).
+ * @param dist Distribution of the inputs.
+ * @param n Base sample size, a power of 2 suits the Sobol points best.
+ * @param seed Seed of the digital shift of the Sobol points.
+ */
+inline SobolIndices sobol_indices(Simulation& sim,
+                                  const DropDistribution& dist, size_t n,
+                                  uint64_t seed = 0) {
+    constexpr size_t K = SaltelliSweep::K;
+    if (n < 2) {
+        throw std::invalid_argument("Saltelli scheme needs n >= 2");
+    }
+    SaltelliSweep sweep(dist, n, seed);
+    std::vector<State<3>> last = sim.run_parallel_sweep(sweep);
+
+    SobolIndices idx;
+    idx.runs = last.size();
+    for (size_t c = 0; c < 2; c++) {
+        auto f = [&](size_t block, size_t j) {
+            return last[block * n + j].X()[c];
+        };
+        double mean = 0, var = 0;
+        for (size_t j = 0; j < 2 * n; j++) {
+            mean += f(j / n, j % n) / (2 * n);
+        }
+        for (size_t j = 0; j < 2 * n; j++) {
+            double d = f(j / n, j % n) - mean;
+            var += d * d / (2 * n - 1);
+        }
+        auto& first = c == 0 ? idx.first_n : idx.first_e;
+        auto& total = c == 0 ? idx.total_n : idx.total_e;
+        (c == 0 ? idx.var_n : idx.var_e) = var;
+        for (size_t i = 0; i < K; i++) {
+            double s = 0, st = 0;
+            for (size_t j = 0; j < n; j++) {
+                double fa = f(0, j), fb = f(1, j), fab = f(2 + i, j);
+                s += fb * (fab - fa);
+                st += (fa - fab) * (fa - fab);
+            }
+            first[i] = var > 0 ? s / n / var : 0;
+            total[i] = var > 0 ? st / (2 * n) / var : 0;
+        }
+    }
+    return idx;
+}
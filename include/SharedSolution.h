@@ -0,0 +1,190 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include "Dispersion.h"
+
+/**
+ * @brief Latest drop solution, as published by the predictor.
+ */
+struct DropSolution {
+    double stamp = 0;           /**< Time of the telemetry used (s) */
+    double drop_lat = 0;        /**< Release point */
+    double drop_lon = 0;
+    double waypoints[6] = {0};  /**< {lat, lon} of first, drop, last */
+    double time_to_release = 0; /**< Time to the release point (s) */
+    LandingSpread spread;       /**< Landing ellipse around the target */
+};
+
+static_assert(std::is_trivially_copyable_v<DropSolution> &&
+                  sizeof(DropSolution) % sizeof(uint64_t) == 0,
+              "DropSolution must be copied as 64 bit words");
+
+/**
+ * @brief Seqlock over a DropSolution, laid out in shared memory.
+ *
+ * The writer makes seq odd, stores the words and makes it even again.
+ * A reader copies the words between two loads of seq and retries while
+ * they differ or are odd, so it never blocks the writer and never sees a
+ * torn solution. The words are relaxed atomics, lock free and address free
+ * on every 64 bit target, which makes the protocol valid across processes.
+ */
+struct SolutionBlock {
+    static constexpr uint32_t MAGIC = 0x4c4f5344;  // "DSOL"
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t N_WORDS = sizeof(DropSolution) / sizeof(uint64_t);
+
+    std::atomic<uint32_t> magic;
+    std::atomic<uint32_t> version;
+    std::atomic<uint64_t> seq;  // Odd while a write is in progress
+    std::atomic<uint64_t> words[N_WORDS];
+
+    void store(const DropSolution& sol) {
+        uint64_t w[N_WORDS];
+        std::memcpy(w, &sol, sizeof(w));
+        uint64_t s = seq.load(std::memory_order_relaxed);
+        seq.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < N_WORDS; i++) {
+            words[i].store(w[i], std::memory_order_relaxed);
+        }
+        seq.store(s + 2, std::memory_order_release);
+    }
+
+    // Consistent copy, false if nothing was published yet
+    bool load(DropSolution& sol, uint64_t* version_out = nullptr) const {
+        uint64_t w[N_WORDS];
+        uint64_t s0, s1;
+        do {
+            s0 = seq.load(std::memory_order_acquire);
+            if (s0 & 1) continue;
+            for (size_t i = 0; i < N_WORDS; i++) {
+                w[i] = words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            s1 = seq.load(std::memory_order_relaxed);
+        } while ((s0 & 1) || s0 != s1);
+        if (version_out) *version_out = s0 / 2;
+        if (s0 == 0) return false;
+        std::memcpy(&sol, w, sizeof(w));
+        return true;
+    }
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "The seqlock needs lock free 64 bit atomics");
+
+/**
+ * @brief Owner of a POSIX shared memory segment with a SolutionBlock.
+ *
+ * Base of SolutionPublisher and SolutionReader, it maps the segment and
+ * unmaps it on destruction.
+ */
+class SharedSegment {
+   public:
+    SharedSegment(const SharedSegment&) = delete;
+    SharedSegment& operator=(const SharedSegment&) = delete;
+
+    ~SharedSegment() {
+        if (block) ::munmap(block, sizeof(SolutionBlock));
+    }
+
+    const std::string& name() const { return shm_name; }
+
+   protected:
+    SharedSegment(const std::string& name, bool writer) : shm_name(name) {
+        int fd = ::shm_open(name.c_str(), writer ? O_CREAT | O_RDWR : O_RDWR,
+                            0644);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open shared memory " + name);
+        }
+        if (writer && ::ftruncate(fd, sizeof(SolutionBlock)) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Cannot size shared memory " + name);
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(SolutionBlock)) {
+            ::close(fd);
+            throw std::runtime_error("Shared memory " + name + " too small");
+        }
+        void* p = ::mmap(nullptr, sizeof(SolutionBlock),
+                         PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) {
+            throw std::runtime_error("Cannot map shared memory " + name);
+        }
+        block = static_cast<SolutionBlock*>(p);
+    }
+
+    std::string shm_name;
+    SolutionBlock* block = nullptr;
+};
+
+/**
+ * @brief Writer side, one per segment.
+ *
+ * Creates the segment if needed (a new one is zero filled, i.e. nothing
+ * published) and removes it on destruction when unlink is set.
+ */
+class SolutionPublisher : public SharedSegment {
+   public:
+    explicit SolutionPublisher(const std::string& name = "/sft_drop",
+                               bool unlink = true)
+        : SharedSegment(name, true), unlink(unlink) {
+        block->version.store(SolutionBlock::VERSION);
+        block->magic.store(SolutionBlock::MAGIC, std::memory_order_release);
+    }
+
+    ~SolutionPublisher() {
+        if (unlink) ::shm_unlink(shm_name.c_str());
+    }
+
+    void publish(const DropSolution& sol) { block->store(sol); }
+
+   private:
+    bool unlink;
+};
+
+/**
+ * @brief Reader side, any number of them in any process.
+ *
+ * The mapping is read-write because the atomic loads may need it, the
+ * reader never stores.
+ */
+class SolutionReader : public SharedSegment {
+   public:
+    explicit SolutionReader(const std::string& name = "/sft_drop")
+        : SharedSegment(name, false) {
+        if (block->magic.load(std::memory_order_acquire) !=
+                SolutionBlock::MAGIC ||
+            block->version.load() != SolutionBlock::VERSION) {
+            throw std::runtime_error("No drop solution in " + name);
+        }
+    }
+
+    /**
+     * @brief Latest solution.
+     *
+     * @param sol Filled with the solution.
+     * @param version Number of solutions published so far, can be NULL.
+     * @return false if nothing was published yet.
+     */
+    bool read(DropSolution& sol, uint64_t* version = nullptr) const {
+        return block->load(sol, version);
+    }
+
+    // Number of solutions published so far, to poll for a new one
+    uint64_t version() const {
+        return block->seq.load(std::memory_order_acquire) / 2;
+    }
+};
@@ -1,17 +1,25 @@
 #pragma once
 
+#include <atomic>
 #include <boost/numeric/odeint.hpp>
+#include <chrono>
 #include <cmath>
 #include <functional>
 #include <memory>
 #include <span>
 #include <string>
 #include <thread>
+#include <type_traits>
 #include <vector>
 
 #include "BaseStepper.h"
+#include "Executor.h"
+#include "Generator.h"
+#include "Interpolation.h"
 #include "Model.h"
+#include "Sampling.h"
 #include "State.h"
+#include "Trace.h"
 
 enum Format { B = 1, KB = 3, MB = 6, GB = 9 };
 
@@ -59,25 +67,117 @@ extern const unsigned N_THREADS{[]() {
     return n_threads;
 }()};
 
+/**
+ * @brief Per thread bump allocator of trajectories.
+ *
+ * Trajectories are appended state by state to fixed size pages, so memory
+ * grows with the states actually integrated instead of being reserved for the
+ * full time interval. When a page fills up the trajectory in progress is moved
+ * to a new page, at least twice its length.
+ */
+template <size_t N>
+class StateArena {
+   public:
+    explicit StateArena(size_t page_size = 4096)
+        : page_size(std::max<size_t>(page_size, 1)) {}
+
+    // Opens a new trajectory
+    void begin() { start = cursor; }
+
+    void push(const State<N>& S) {
+        if (cursor == capacity) {
+            grow();
+        }
+        page[cursor++] = S;
+    }
+
+    // Closes the trajectory in progress and returns its view
+    std::span<State<N>> end() {
+        return {page + start, cursor - start};
+    }
+
+    std::vector<std::unique_ptr<State<N>[]>> release() {
+        page = nullptr;
+        start = cursor = capacity = 0;
+        return std::move(pages);
+    }
+
+   private:
+    void grow() {
+        SFT_TRACE_SPAN("sim", "alloc");
+        size_t len = cursor - start;
+        size_t cap = std::max(page_size, 2 * len);
+        try {
+            pages.push_back(std::make_unique<State<N>[]>(cap));
+        } catch (std::bad_alloc& ba) {
+            // Handle bad_alloc
+            handle_bad_alloc(ba, cap * sizeof(State<N>), MB);
+        }
+        State<N>* next = pages.back().get();
+        std::copy(page + start, page + cursor, next);
+        page = next;
+        start = 0;
+        cursor = len;
+        capacity = cap;
+    }
+
+    size_t page_size;
+    std::vector<std::unique_ptr<State<N>[]>> pages;
+    State<N>* page = nullptr;  // Page being filled
+    size_t start = 0;          // First state of the trajectory in progress
+    size_t cursor = 0;         // First free state of the page
+    size_t capacity = 0;       // Size of the page
+};
+
 template <size_t N>
 struct Results {
    private:
-    std::unique_ptr<State<N>[]> results;
+    std::vector<std::unique_ptr<State<N>[]>> results;  // Owned pages
     std::vector<std::span<State<N>>> results_view;
+    std::vector<std::span<State<N>>> derivs_view;  // Dense output, optional
+    std::vector<size_t> offsets;      // Trajectory starts, after compact()
+    std::vector<double> tail_errors;  // Error bound of the terminal tail jump
+
+    // Copies the views in a single buffer and points them to it
+    static std::unique_ptr<State<N>[]> _pack(
+        std::vector<std::span<State<N>>>& views, size_t total) {
+        std::unique_ptr<State<N>[]> buffer;
+        try {
+            buffer = std::make_unique<State<N>[]>(total);
+        } catch (std::bad_alloc& ba) {
+            // Handle bad_alloc
+            handle_bad_alloc(ba, total * sizeof(State<N>), MB);
+        }
+        size_t offset = 0;
+        for (auto& sp : views) {
+            std::copy(sp.begin(), sp.end(), buffer.get() + offset);
+            sp = {buffer.get() + offset, sp.size()};
+            offset += sp.size();
+        }
+        return buffer;
+    }
 
    public:
-    Results() : results(nullptr) {}
-    Results(State<N>* res, std::span<State<N>> res_span) : results(res) {
+    Results() {}
+    Results(State<N>* res, std::span<State<N>> res_span) {
+        results.emplace_back(res);
         results_view.push_back(res_span);
     }
 
     Results(State<N>* res, std::vector<std::span<State<N>>> res_spans)
-        : results(res), results_view(res_spans) {}
+        : results_view(res_spans) {
+        results.emplace_back(res);
+    }
+    Results(std::vector<std::unique_ptr<State<N>[]>> pages,
+            std::vector<std::span<State<N>>> res_spans)
+        : results(std::move(pages)), results_view(res_spans) {}
+    Results(Results&& other) = default;
+    Results& operator=(Results&& other) = default;
     ~Results() {}
 
     // View only operator, doenst allow to modify the results
     const std::span<State<N>>& operator[](size_t i) const {
-        if (results) {
+        if (!results.empty()) {
             if (i >= results_view.size() || results_view[i].empty()) {
                 throw std::out_of_range("Index out of range");
             }
@@ -91,7 +191,7 @@ struct Results {
     }
 
     State<N> getLast(size_t idx = 0) {
-        if (results) {
+        if (!results.empty()) {
             if (results_view.size() >= idx) {
                 return results_view[idx].back();
             } else {
@@ -101,8 +201,89 @@ struct Results {
             throw std::runtime_error("Results not initialized");
         }
     }
-    bool sanityCheck() { return results; }
+    bool sanityCheck() { return !results.empty(); }
     size_t getSSize() { return results_view.size(); }
+
+    /**
+     * @brief Packs all the trajectories in a single contiguous buffer.
+     *
+     * Trajectory i is then data()[getOffsets()[i]] ... data()[getOffsets()[i
+     * + 1] - 1]. Derivatives, if stored, are packed the same way in
+     * derivsData(). Views returned before the call are invalidated, and the
+     * states are copied once, so the peak memory doubles while packing.
+     */
+    void compact() {
+        size_t total = 0;
+        for (const auto& sp : results_view) {
+            total += sp.size();
+        }
+        offsets.assign(results_view.size() + 1, 0);
+        for (size_t i = 0; i < results_view.size(); i++) {
+            offsets[i + 1] = offsets[i] + results_view[i].size();
+        }
+        std::vector<std::unique_ptr<State<N>[]>> packed;
+        packed.push_back(_pack(results_view, total));
+        if (!derivs_view.empty()) {
+            packed.push_back(_pack(derivs_view, total));
+        }
+        results = std::move(packed);
+    }
+    // Contiguous buffer and trajectory offsets, valid after compact()
+    const State<N>* data() const {
+        return offsets.empty() ? nullptr : results.front().get();
+    }
+    const State<N>* derivsData() const {
+        return offsets.empty() || derivs_view.empty() ? nullptr
+                                                      : results[1].get();
+    }
+    const std::vector<size_t>& getOffsets() const { return offsets; }
+
+    /**
+     * @brief Stores the derivative of every state, enabling Hermite dense
+     * output in stateAt() and stateAtAltitude().
+     *
+     * @param pages Pages owning the derivatives, kept alive by the Results.
+     * @param d_spans d_spans[i][j] is the derivative of (*this)[i][j].
+     */
+    void setDerivatives(std::vector<std::unique_ptr<State<N>[]>> pages,
+                        std::vector<std::span<State<N>>> d_spans) {
+        for (auto& page : pages) {
+            results.push_back(std::move(page));
+        }
+        derivs_view = std::move(d_spans);
+    }
+    bool hasDerivatives() const { return !derivs_view.empty(); }
+
+    // Interpolator of trajectory idx, cubic in the states if derivatives
+    // were stored, cubic in position and linear in velocity otherwise
+    DenseTrajectory<N> dense(size_t idx = 0) const {
+        const std::span<State<N>>& sp = (*this)[idx];
+        if (hasDerivatives()) {
+            return DenseTrajectory<N>(sp, derivs_view[idx]);
+        }
+        return DenseTrajectory<N>(sp);
+    }
+    // State of trajectory idx at time t, O(log n)
+    State<N> stateAt(size_t idx, double t) const {
+        return dense(idx).at_time(t);
+    }
+    // State of trajectory idx when crossing altitude h, O(log n). Returns
+    // false if the trajectory never reaches h
+    bool stateAtAltitude(size_t idx, double h, State<N>& S) const {
+        return dense(idx).at_altitude(h, S);
+    }
+
+    void setTailErrors(std::vector<double> errs) {
+        tail_errors = std::move(errs);
+    }
+    // Error bound (m) of the analytic tail of trajectory idx, 0 if the
+    // trajectory was integrated down to the ground
+    double getTailError(size_t idx = 0) const {
+        if (idx < tail_errors.size()) {
+            return tail_errors[idx];
+        }
+        return 0;
+    }
 };
 
 /**
@@ -111,9 +292,10 @@ struct Results {
  */
 typedef struct {
     // Methods parameters
-    double dt;          /**< Time step */
-    double T;           /**< Total simulation time */
-    std::string method; /**< ODE solving method */
+    double dt;           /**< Time step */
+    double T;            /**< Total simulation time */
+    std::string method;  /**< ODE solving method */
+    double tail_tol = 0; /**< Terminal tail tolerance, 0 disables it */
 } ODESettings;
 
 /**
@@ -126,11 +308,85 @@ class Simulation {
     Method m;             /**< ODE solving method */
     double time_step;     /**< Time step for simulation. */
     double time_interval; /**< Time interval for simulation. */
+    double tail_tol = 0;  /**< Acceleration tolerance of the terminal tail. */
+    size_t page_size = 4096; /**< States per page of the result arenas. */
+    bool dense_output = false; /**< Store derivatives for interpolation. */
+    Priority priority = Priority::NORMAL; /**< Class of the sweeps. */
+    std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::time_point::max(); /**< Of every run. */
 
     template <typename ModelType, size_t N = ModelType::getN()>
     std::span<State<N>> _run(ModelType h, State<N> S0,
                              std::span<State<N>> res_span,
-                             BaseStepper<ModelType>* stepper);
+                             BaseStepper<ModelType>* stepper,
+                             double* tail_err = nullptr);
+
+    template <typename ModelType, typename Observer,
+              size_t N = ModelType::getN()>
+    size_t _integrate(ModelType& h, State<N> S0, size_t n_steps,
+                      BaseStepper<ModelType>* stepper, Observer&& obs,
+                      double* tail_err = nullptr,
+                      State<N>* crossing = nullptr);
+
+    // Endpoint-only integrator, nothing but the last state is stored
+    template <typename ModelType, size_t N = ModelType::getN()>
+    State<N> _run_end(ModelType h, State<N> S0,
+                      BaseStepper<ModelType>* stepper,
+                      double* tail_err = nullptr);
+
+    // Same as _run, appending the results to a growable arena
+    template <typename ModelType, size_t N = ModelType::getN()>
+    std::span<State<N>> _run_arena(ModelType h, State<N> S0,
+                                   StateArena<N>& arena,
+                                   BaseStepper<ModelType>* stepper,
+                                   double* tail_err = nullptr);
+
+    // Only the states at the events are recorded, interpolated with
+    // hermite() over the step that contains each of them
+    template <typename ModelType, size_t N = ModelType::getN()>
+    void _run_sampled(ModelType& h, State<N> S0,
+                      BaseStepper<ModelType>* stepper,
+                      const SampleEvents& events, std::span<State<N>> record,
+                      std::span<uint8_t> flags);
+
+    template <typename ModelType, size_t N = ModelType::getN()>
+    static Generator<State<N>> _stream(Simulation sim, ModelType h,
+                                       State<N> S0);
+
+    // Evaluates the model at every state of traj, appending to arena
+    template <typename ModelType, size_t N = ModelType::getN()>
+    static std::span<State<N>> _derivatives(ModelType& h,
+                                            std::span<State<N>> traj,
+                                            StateArena<N>& arena);
+
+    template <size_t N>
+    static std::vector<std::unique_ptr<State<N>[]>> _collect_pages(
+        std::vector<StateArena<N>>& arenas);
+
+    template <typename ModelType>
+    BaseStepper<ModelType>* _make_stepper() const;
+
+    // Stop condition of the model, either a condition() member or the
+    // conditionFunc std::function of Model
+    template <typename ModelType, size_t N>
+    static bool _has_condition(const ModelType& h) {
+        if constexpr (requires(const State<N>& S, double t) {
+                          h.condition(S, S, t);
+                      }) {
+            return true;
+        } else {
+            return bool(h.conditionFunc);
+        }
+    }
+    template <typename ModelType, size_t N>
+    static bool _stop(ModelType& h, const State<N>& S, State<N>& S_next,
+                      double t) {
+        if constexpr (requires { h.condition(S, S_next, t); }) {
+            return h.condition(S, S_next, t);
+        } else {
+            return h.conditionFunc(S, S_next, t);
+        }
+    }
 
    public:
     /**
@@ -175,7 +431,78 @@ class Simulation {
      * @param settings ODESettings object containing simulation settings.
      */
     Simulation(ODESettings settings)
-        : Simulation(settings.dt, settings.T, settings.method) {}
+        : Simulation(settings.dt, settings.T, settings.method) {
+        set_terminal_tail(settings.tail_tol);
+    }
+
+    /**
+     * @brief Enables the analytic terminal tail.
+     *
+     * When the model provides terminal_tail(), integration stops as soon as
+     * the acceleration falls below tol and the descent to the ground is
+     * completed in closed form. The error bound of the jump is stored in
+     * the Results.
+     *
+     * @param tol Acceleration tolerance (m/s^2), 0 disables the fast path.
+     */
+    void set_terminal_tail(double tol) {
+        if (tol < 0) {
+            throw std::invalid_argument("tail tolerance must be positive");
+        }
+        this->tail_tol = tol;
+    }
+
+    /**
+     * @brief Sets the number of states per page of the result arenas used by
+     * the parallel runs. Longer trajectories get their own larger page.
+     *
+     * @param n_states States per page.
+     */
+    void set_page_size(size_t n_states) {
+        if (n_states == 0) {
+            throw std::invalid_argument("page size must be nonzero positive");
+        }
+        this->page_size = n_states;
+    }
+
+    /**
+     * @brief Stores the derivative of every state in the Results, so that
+     * Results::stateAt() and stateAtAltitude() interpolate with cubic
+     * Hermite polynomials. Costs one model evaluation per stored state.
+     *
+     * @param enable true to store the derivatives.
+     */
+    void set_dense_output(bool enable) { this->dense_output = enable; }
+
+    /**
+     * @brief Sets the priority class of the parallel runs on the shared
+     * Executor, see Executor.h.
+     *
+     * @param p LIVE for queries someone waits for, BULK for background
+     * sweeps.
+     */
+    void set_priority(Priority p) { this->priority = p; }
+
+    /**
+     * @brief Stops the runs of this Simulation at the given time.
+     *
+     * Integrations check the clock every 64 steps and end early once it is
+     * passed, so what they return is then not a landing: check expired()
+     * before using the results. stream() is not affected, its consumer
+     * stops it.
+     *
+     * @param t Deadline, time_point::max() (the default) disables it.
+     */
+    void set_deadline(std::chrono::steady_clock::time_point t) {
+        this->deadline = t;
+    }
+
+    bool expired() const {
+        return std::chrono::steady_clock::now() >= deadline;
+    }
+
+    double get_time_step() const { return time_step; }
+    double get_time_interval() const { return time_interval; }
 
     /**
      * @brief Changes the simulation settings.
@@ -196,9 +523,27 @@ class Simulation {
     template <typename ModelType, size_t N = ModelType::getN()>
     Results<N> run(ModelType h, State<N> S0);
 
+    /**
+     * @brief Runs a single simulation on the calling thread, keeping only
+     * the last state.
+     *
+     * Nothing but the stepper is allocated, for callers that solve one
+     * drop at a time in a loop of their own, e.g. the Predictor.
+     *
+     * @param h ModelType object, has to inherit from Model<N>.
+     * @param S0 Initial State<N> of the system.
+     * @param tail_err Error bound of the terminal tail (m), can be NULL.
+     */
+    template <typename ModelType, size_t N = ModelType::getN()>
+    State<N> run_last(ModelType h, State<N> S0, double* tail_err = nullptr) {
+        std::unique_ptr<BaseStepper<ModelType>> stepper(
+            _make_stepper<ModelType>());
+        return _run_end(h, S0, stepper.get(), tail_err);
+    }
+
     /**
      * @brief Runs the simulation in parallel for multiple initial
-     * conditions.
+     * conditions, on the shared Executor at the priority of set_priority().
      *
      * @param h ModelType object, has to inherit from Model<N>.
      * @param v_S0 Vector of initial states of the system.
@@ -206,87 +551,404 @@ class Simulation {
      */
     template <typename ModelType, size_t N = ModelType::getN()>
     Results<N> run_parallel_ic(ModelType h, std::span<State<N>> v_S0);
+
+    /**
+     * @brief Runs the simulation in parallel for a batch of models with
+     * different parameters.
+     *
+     * The batch is called with the index of each initial condition and
+     * returns the model to integrate it with, e.g. LaunchBatch which keeps
+     * the per launch parameters as structure of arrays. Models are built on
+     * the workers of the shared Executor, one at a time, at the priority of
+     * set_priority().
+     *
+     * @param batch Callable batch(j) returning a ModelType, with a size()
+     * member equal to v_S0.size().
+     * @param v_S0 Vector of initial states of the system.
+     */
+    template <typename Batch,
+              typename ModelType = std::invoke_result_t<const Batch&, size_t>,
+              size_t N = ModelType::getN()>
+    Results<N> run_parallel_batch(const Batch& batch,
+                                  std::span<State<N>> v_S0);
+
+    /**
+     * @brief Streams the states of a single run as they are integrated.
+     *
+     * Nothing is stored: each state is yielded as soon as it is accepted,
+     * same stop condition and terminal tail as run(). The generator keeps a
+     * copy of the settings, and destroying it stops the integration.
+     *
+     * @param h ModelType object, has to inherit from Model<N>.
+     * @param S0 Initial State<N> of the system.
+     */
+    template <typename ModelType, size_t N = ModelType::getN()>
+    Generator<State<N>> stream(ModelType h, State<N> S0) const {
+        return _stream(*this, std::move(h), S0);
+    }
+
+    /**
+     * @brief Runs the simulation in parallel over a lazily generated sweep,
+     * keeping only the last state of each run.
+     *
+     * Chunks of consecutive indices run on the shared Executor, at the
+     * priority of set_priority(), and build the model and initial state of
+     * each index on the fly with sweep.at(idx), so no input is
+     * materialized. The result is dense and ordered as the sweep indices,
+     * e.g. row-major over the axes of a DropSweep.
+     *
+     * @param sweep Object with size() and at(idx) returning a pair
+     * {ModelType, State<N>}.
+     * @param chunk Number of consecutive indices taken by a thread at once.
+     * @param tail_err tail_err[idx] is the error bound of the terminal tail,
+     * resized to the sweep size, can be NULL.
+     */
+    template <typename Sweep,
+              typename ModelType = decltype(std::declval<const Sweep&>()
+                                                .at(size_t())
+                                                .first),
+              size_t N = ModelType::getN()>
+    std::vector<State<N>> run_parallel_sweep(
+        const Sweep& sweep, size_t chunk = 256,
+        std::vector<double>* tail_err = nullptr);
+
+    /**
+     * @brief Same as run_parallel_sweep, but only the states at the given
+     * events are kept, in a fixed size record per index.
+     *
+     * Trajectories are never stored: each step is checked against the
+     * events and the crossed ones are interpolated with cubic Hermite
+     * polynomials, evaluating the model at the ends of that step only. The
+     * impact is interpolated the same way at the ground crossing.
+     *
+     * @param sweep Object with size() and at(idx) returning a pair
+     * {ModelType, State<N>}.
+     * @param events Altitude levels and time marks to record.
+     * @param chunk Number of consecutive indices taken by a thread at once.
+     */
+    template <typename Sweep,
+              typename ModelType = decltype(std::declval<const Sweep&>()
+                                                .at(size_t())
+                                                .first),
+              size_t N = ModelType::getN()>
+    SampledResults<N> run_parallel_sweep(const Sweep& sweep,
+                                         const SampleEvents& events,
+                                         size_t chunk = 256);
 };
 
 // Implementations
 
 namespace odeint = boost::numeric::odeint;
 
+template <typename ModelType, typename Observer, size_t N>
+size_t Simulation::_integrate(ModelType& h, State<N> S0, size_t n_steps,
+                              BaseStepper<ModelType>* stepper, Observer&& obs,
+                              double* tail_err, State<N>* crossing) {
+    /**
+     * Integrates the model from S0 for at most n_steps steps, handing every
+     * accepted state (S0 included) to obs. Integration stops when the model
+     * condition is met, when the terminal tail jumps to the ground or when
+     * obs returns false.
+     *
+     * @param h The Model object to use for the simulation.
+     * @param S0 The initial state of the simulation.
+     * @param n_steps Maximum number of steps.
+     * @param stepper The stepper to use.
+     * @param obs Callable bool(const State<N>&), false stops the integration.
+     * @param tail_err Where to store the error bound of the terminal tail.
+     * @param crossing Where to store the step that met the model condition,
+     * which is not handed to obs. Untouched if the condition is never met.
+     * @return The number of states handed to obs.
+     */
+
+    // --- Compile time instructions ---
+
+    static_assert(std::is_base_of<Model<N>, ModelType>::value,
+                  "ModelType must be derived from Model");
+
+    if (!obs(S0)) {
+        return 1;
+    }
+    stepper->reset();  // Steppers are shared by the runs of a thread
+    State<N> out;
+    State<N> S0_step = S0;
+    double t = 0;
+
+    /*
+        Might be nice to add a check of multiple conditions, modifyng
+       the internal Model.operator() to another ode law Can try to
+       enable 2 or more functions objects, returning the sum of ode laws
+       But in this way i need to figure how to stop integration where it
+       doesnt make sense
+
+        For now it just stops integration and gg
+    */
+    const bool has_condition = _has_condition<ModelType, N>(h);
+    const bool timed =
+        deadline != std::chrono::steady_clock::time_point::max();
+
+    for (size_t i = 0; i < n_steps; i++) {
+        if (timed && (i & 63) == 63 && expired()) {
+            return i + 1;  // Out of time, see set_deadline
+        }
+        t = i * time_step;
+        stepper->do_step(h, S0_step, t, out, time_step);
+
+        if (has_condition &&
+            _stop(h, S0_step, out, t + time_step)) {  // TODO: Da toccare
+            // Would be nice to do a weighted average of the last two
+            // states until last.z > 0
+            if (crossing) {
+                *crossing = out(t + time_step);
+            }
+            return i + 1;
+        }
+        if (!obs(out(t + time_step))) {
+            return i + 2;
+        }
+        S0_step = out;
+
+        if constexpr (requires(State<N> & S, double e) {
+                          h.terminal_tail(S, t, tail_tol, S, e);
+                      }) {
+            // Jump to the ground once the payload is quasi-steady
+            State<N> S_ground;
+            double err;
+            if (tail_tol > 0 && i + 2 <= n_steps &&
+                h.terminal_tail(S0_step, t + time_step, tail_tol, S_ground,
+                                err)) {
+                obs(S_ground);
+                if (tail_err) {
+                    *tail_err = err;
+                }
+                return i + 3;
+            }
+        }
+    }
+
+    return n_steps + 1;  // If the condition is never met, return the last
+                         // state
+}
+
 template <typename ModelType, size_t N>
 std::span<State<N>> Simulation::_run(ModelType h, State<N> S0,
                                      std::span<State<N>> w_span,
-                                     BaseStepper<ModelType>* stepper) {
+                                     BaseStepper<ModelType>* stepper,
+                                     double* tail_err) {
     /**
      * Runs the dynamical model simulation using the provided Model object
-     * and initial state. If a pointer to a State object is provided, the
-     * results will be stored in it. Otherwise, memory will be allocated for
-     * the results.
-     * .
+     * and initial state, storing the results in w_span.
      *
      * @param h Pointer to the Model object to use for the simulation.
      * @param S0 The initial state of the simulation.
      * @param res_span Pointer to a State object to store the results in.
      * Default is nullptr.
+     * @param tail_err Where to store the error bound of the terminal tail.
      * @note If res_span is given, memory must be managed by the caller
      */
+    size_t k = 0;
+    size_t n = _integrate(
+        h, S0, w_span.size() - 1, stepper,
+        [&](const State<N>& S) {
+            w_span[k++] = S;
+            return true;
+        },
+        tail_err);
+    return w_span.subspan(0, n);
+}
 
-    // --- Compile time instructions ---
+template <typename ModelType, size_t N>
+State<N> Simulation::_run_end(ModelType h, State<N> S0,
+                              BaseStepper<ModelType>* stepper,
+                              double* tail_err) {
+    // Same as _run, but only the last state is kept
+    const size_t n_steps = ceil(this->time_interval / this->time_step);
+    State<N> last;
+    _integrate(
+        h, S0, n_steps, stepper,
+        [&](const State<N>& S) {
+            last = S;
+            return true;
+        },
+        tail_err);
+    return last;
+}
+
+template <typename ModelType, size_t N>
+std::span<State<N>> Simulation::_run_arena(ModelType h, State<N> S0,
+                                           StateArena<N>& arena,
+                                           BaseStepper<ModelType>* stepper,
+                                           double* tail_err) {
+    // Same as _run, but the results are appended to arena
+    const size_t n_steps = ceil(this->time_interval / this->time_step);
+    arena.begin();
+    _integrate(
+        h, S0, n_steps, stepper,
+        [&](const State<N>& S) {
+            arena.push(S);
+            return true;
+        },
+        tail_err);
+    return arena.end();
+}
+
+template <typename ModelType, size_t N>
+void Simulation::_run_sampled(ModelType& h, State<N> S0,
+                              BaseStepper<ModelType>* stepper,
+                              const SampleEvents& events,
+                              std::span<State<N>> record,
+                              std::span<uint8_t> flags) {
+    const size_t n_steps = ceil(this->time_interval / this->time_step);
+    const size_t n_alt = events.altitudes.size();
+    const size_t n_time = events.times.size();
+    std::fill(flags.begin(), flags.end(), 0);
+
+    State<N> prev;
+    State<N> next = S0;
+
+    // Records the events of the step from prev to S, time marks up to
+    // t_end. The model is evaluated only on the steps holding an event
+    auto sample = [&](const State<N>& S, double t_end) {
+        State<N> F0, F1;
+        bool has_derivs = false;
+        auto derivs = [&]() {
+            if (!has_derivs) {
+                h(prev, F0, prev.get_t());
+                h(S, F1, S.get_t());
+                has_derivs = true;
+            }
+        };
+        for (size_t k = 0; k < n_alt; k++) {
+            double z = -events.altitudes[k];
+            if (!flags[k] && prev.X()[2] < z && z <= S.X()[2]) {
+                derivs();
+                record[k] = hermite_crossing(prev, F0, S, F1, 2, z);
+                flags[k] = 1;
+            }
+        }
+        for (size_t k = 0; k < n_time; k++) {
+            double t = events.times[k];
+            if (!flags[n_alt + k] && prev.get_t() < t && t <= t_end) {
+                derivs();
+                double theta = (t - prev.get_t()) / (S.get_t() - prev.get_t());
+                record[n_alt + k] = hermite(prev, F0, S, F1, theta);
+                flags[n_alt + k] = 1;
+            }
+        }
+    };
+
+    bool first = true;
+    _integrate(
+        h, S0, n_steps, stepper,
+        [&](const State<N>& S) {
+            if (first) {
+                // Marks at or before the release are the release itself
+                for (size_t k = 0; k < n_alt; k++) {
+                    if (S.X()[2] == -events.altitudes[k]) {
+                        record[k] = S;
+                        flags[k] = 1;
+                    }
+                }
+                for (size_t k = 0; k < n_time; k++) {
+                    if (events.times[k] <= S.get_t()) {
+                        record[n_alt + k] = S;
+                        flags[n_alt + k] = 1;
+                    }
+                }
+                first = false;
+            } else {
+                sample(S, S.get_t());
+            }
+            prev = S;
+            return true;
+        },
+        nullptr, &next);
 
+    // The step that went below the ground is not part of the run: the
+    // impact is interpolated on it, as the altitude levels, and the events
+    // before the impact are still recorded
+    State<N> impact = prev;
+    if (next.get_t() > prev.get_t() && prev.X()[2] < 0 &&
+        next.X()[2] >= 0) {
+        State<N> F0, F1;
+        h(prev, F0, prev.get_t());
+        h(next, F1, next.get_t());
+        impact = hermite_crossing(prev, F0, next, F1, 2, 0.0);
+        sample(next, impact.get_t());
+    }
+    record[events.impactIndex()] = impact;
+    flags[events.impactIndex()] = 1;
+}
+
+template <typename ModelType, size_t N>
+Generator<State<N>> Simulation::_stream(Simulation sim, ModelType h,
+                                        State<N> S0) {
+    // Coroutine body of stream(), sim is a copy so the generator does not
+    // depend on the lifetime of the Simulation that created it
     static_assert(std::is_base_of<Model<N>, ModelType>::value,
                   "ModelType must be derived from Model");
 
-    int n_steps = w_span.size() - 1;
+    std::unique_ptr<BaseStepper<ModelType>> stepper(
+        sim._make_stepper<ModelType>());
+    const size_t n_steps = ceil(sim.time_interval / sim.time_step);
+    const double dt = sim.time_step;
+    const bool has_condition = _has_condition<ModelType, N>(h);
 
-    w_span[0] = S0;
+    co_yield S0;
     State<N> out;
-    State<N> S0_step = S0;
-    double t = 0;
+    State<N> S = S0;
+    for (size_t i = 0; i < n_steps; i++) {
+        double t = i * dt;
+        stepper->do_step(h, S, t, out, dt);
+        if (has_condition && _stop(h, S, out, t + dt)) {
+            co_return;
+        }
+        co_yield out(t + dt);
+        S = out;
 
-    if (h.conditionFunc) {
-        /*
-            Might be nice to add a check of multiple conditions, modifyng
-           the internal Model.operator() to another ode law Can try to
-           enable 2 or more functions objects, returning the sum of ode laws
-           But in this way i need to figure how to stop integration where it
-           doesnt make sense
-
-            For now it just stops integration and gg
-        */
-
-        // Condition function is defined, run until condition is met
-        for (int i = 0; i < n_steps; i++) {
-            t = i * time_step;
-            stepper->do_step(h, S0_step, t, out, time_step);
-
-            if (h.conditionFunc(S0_step, out,
-                                t + time_step)) {  // TODO: Da toccare
-                // Would be nice to do a weighted average of the last two
-                // states until last.z > 0
-                return w_span.subspan(0, i + 1);
+        if constexpr (requires(State<N> & S_, double e) {
+                          h.terminal_tail(S_, t, sim.tail_tol, S_, e);
+                      }) {
+            State<N> S_ground;
+            double err;
+            if (sim.tail_tol > 0 &&
+                h.terminal_tail(S, t + dt, sim.tail_tol, S_ground, err)) {
+                co_yield S_ground;
+                co_return;
             }
-            w_span[i + 1] = out(t + time_step);
-            S0_step = out;
-        }
-    } else {
-        // Condition function is not defined, run for n_steps witthout checking
-        // conditions
-        for (int i = 0; i < n_steps; i++) {
-            t = i * time_step;
-            stepper->do_step(h, S0_step, t, out, time_step);
-            w_span[i + 1] = out(t + time_step);
-            S0_step = out;
         }
     }
-
-    return w_span;  // If the condition is never met, return the last
-                    // state
 }
 
 template <typename ModelType, size_t N>
-Results<N> Simulation::run(ModelType h, State<N> S0) {
-    // ...
-    const size_t n_steps = ceil(this->time_interval / this->time_step);
-    BaseStepper<ModelType>* stepper;
+std::span<State<N>> Simulation::_derivatives(ModelType& h,
+                                             std::span<State<N>> traj,
+                                             StateArena<N>& arena) {
+    arena.begin();
+    State<N> F;
+    for (const State<N>& S : traj) {
+        h(S, F, S.get_t());
+        arena.push(F(S.get_t()));
+    }
+    return arena.end();
+}
+
+template <size_t N>
+std::vector<std::unique_ptr<State<N>[]>> Simulation::_collect_pages(
+    std::vector<StateArena<N>>& arenas) {
+    SFT_TRACE_SPAN("sim", "collect");
+    std::vector<std::unique_ptr<State<N>[]>> pages;
+    for (auto& arena : arenas) {
+        for (auto& page : arena.release()) {
+            pages.push_back(std::move(page));
+        }
+    }
+    return pages;
+}
+
+template <typename ModelType>
+BaseStepper<ModelType>* Simulation::_make_stepper() const {
+    BaseStepper<ModelType>* stepper = nullptr;
     try {
         if (m == rk4) {
             stepper = new RK4Stepper<ModelType>();
@@ -301,6 +963,14 @@ Results<N> Simulation::run(ModelType h, State<N> S0) {
         // Handle bad_alloc
         handle_bad_alloc(ba, sizeof(BaseStepper<ModelType>), B);
     }
+    return stepper;
+}
+
+template <typename ModelType, size_t N>
+Results<N> Simulation::run(ModelType h, State<N> S0) {
+    // ...
+    const size_t n_steps = ceil(this->time_interval / this->time_step);
+    BaseStepper<ModelType>* stepper = _make_stepper<ModelType>();
 
     // Allocate memory for results
     State<N>* res;
@@ -311,84 +981,174 @@ Results<N> Simulation::run(ModelType h, State<N> S0) {
         handle_bad_alloc(ba, (n_steps + 1) * sizeof(State<N>), KB);
     }
     // Run simulation
-    std::span<State<N>> r_sp = _run(h, S0, {res, n_steps + 1}, stepper);
+    double tail_err = 0;
+    std::span<State<N>> r_sp =
+        _run(h, S0, {res, n_steps + 1}, stepper, &tail_err);
 
     // Clean stepper
     delete stepper;
-    return Results(res, r_sp);
+    Results<N> results(res, r_sp);
+    results.setTailErrors({tail_err});
+    if (dense_output) {
+        StateArena<N> d_arena(r_sp.size());
+        std::span<State<N>> d_sp = _derivatives(h, r_sp, d_arena);
+        results.setDerivatives(d_arena.release(), {d_sp});
+    }
+    return results;
 }
 
 template <typename ModelType, size_t N>
 Results<N> Simulation::run_parallel_ic(ModelType h, std::span<State<N>> v_S0) {
     // Runs the simulation for each initial condition in v_S0
+    SFT_TRACE_SPAN("sim", "run_parallel_ic");
 
     // Check if ModelType is derived from Model
     static_assert(std::is_base_of<Model<N>, ModelType>::value,
                   "ModelType must be derived from Model");
 
-    // This needs to be modyfied for multistep methods, as each method needs its
-    // own stepper
-    // Create an array of BaseStepper[N_THREADS] pointers and instantiate each
-    // pointer with the correct stepper
-    BaseStepper<ModelType>** stepper;
-    try {
-        stepper = new BaseStepper<ModelType>*[N_THREADS];
-        for (size_t i = 0; i < N_THREADS; i++) {
-            if (m == rk4) {
-                stepper[i] = new RK4Stepper<ModelType>();
-            } else if (m == rk45) {
-                stepper[i] = new RK45Stepper<ModelType>();
-            } else if (m == euler) {
-                stepper[i] = new EulerStepper<ModelType>();
-            } else {
-                throw std::invalid_argument("Invalid method");
-            }
-        }
-    } catch (std::bad_alloc& ba) {
-        // Handle bad_alloc
-        handle_bad_alloc(ba, N_THREADS * sizeof(BaseStepper<ModelType>*), KB);
-    }
-
     size_t const& n_ic = v_S0.size();
-    const size_t n_steps = ceil(this->time_interval / this->time_step);
 
-    // Allocate memory for results
-    State<N>* res;
-    try {
-        res = new State<N>[n_ic * (n_steps + 1)];
-    } catch (std::bad_alloc& ba) {
-        // Handle bad_alloc
-        handle_bad_alloc(ba, (n_steps + 1) * sizeof(State<N>), MB);
+    // Results grow in per worker arenas as trajectories advance, the last
+    // one is for the caller when it runs chunks of its own job
+    Executor& ex = Executor::shared();
+    std::vector<StateArena<N>> arenas, d_arenas;
+    for (size_t i = 0; i <= ex.size(); i++) {
+        arenas.emplace_back(page_size);
+        d_arenas.emplace_back(page_size);
     }
 
     std::vector<std::span<State<N>>> v_res_spans(
         n_ic);  // Reserve space for return spans
-    // Create threads
-    std::vector<std::thread> threads(N_THREADS);
-
-    for (size_t i = 0; i < N_THREADS; i++) {
-        threads[i] = std::thread([&, i]() {
-            size_t thread_id = i;
-
-            for (auto j = thread_id; j < n_ic; j += N_THREADS) {
-                State<N> const& S0 = v_S0[j];
-                std::span<State<N>> r_sp = _run(
-                    h, S0, {res + j * (n_steps + 1), n_steps + 1}, stepper[i]);
-                // No need to lock res_spans for write
-                v_res_spans[j] = r_sp;
-                // if stepper is multi step, it needs to be cleaned here
+    std::vector<std::span<State<N>>> v_der_spans(dense_output ? n_ic : 0);
+    std::vector<double> v_tail_errs(n_ic, 0);
+
+    const size_t chunk = std::max<size_t>(1, n_ic / (4 * ex.size()));
+    ex.parallel_for(priority, n_ic, chunk, [&](size_t begin, size_t end) {
+        // This needs to be modyfied for multistep methods, as each method
+        // needs its own stepper
+        std::unique_ptr<BaseStepper<ModelType>> stepper(
+            _make_stepper<ModelType>());
+        const size_t w = ex.worker_index();
+        for (size_t j = begin; j < end; j++) {
+            SFT_TRACE_SPAN("sim", "integrate", j);
+            State<N> const& S0 = v_S0[j];
+            std::span<State<N>> r_sp = _run_arena(h, S0, arenas[w],
+                                                  stepper.get(),
+                                                  &v_tail_errs[j]);
+            // No need to lock res_spans for write
+            v_res_spans[j] = r_sp;
+            if (dense_output) {
+                v_der_spans[j] = _derivatives(h, r_sp, d_arenas[w]);
             }
-        });
+        }
+    });
+
+    Results<N> results(_collect_pages(arenas), v_res_spans);
+    results.setTailErrors(std::move(v_tail_errs));
+    if (dense_output) {
+        results.setDerivatives(_collect_pages(d_arenas),
+                               std::move(v_der_spans));
+    }
+    return results;
+}
+
+
+template <typename Batch, typename ModelType, size_t N>
+Results<N> Simulation::run_parallel_batch(const Batch& batch,
+                                          std::span<State<N>> v_S0) {
+    // Runs the simulation for each initial condition in v_S0, with the model
+    // batch(j) for the j-th one
+    SFT_TRACE_SPAN("sim", "run_parallel_batch");
+
+    static_assert(std::is_base_of<Model<N>, ModelType>::value,
+                  "ModelType must be derived from Model");
+
+    size_t const& n_ic = v_S0.size();
+    if (batch.size() != n_ic) {
+        throw std::invalid_argument(
+            "batch and initial conditions must have the same size");
     }
+    // One result arena per worker, and one for the caller
+    Executor& ex = Executor::shared();
+    std::vector<StateArena<N>> arenas, d_arenas;
+    for (size_t i = 0; i <= ex.size(); i++) {
+        arenas.emplace_back(page_size);
+        d_arenas.emplace_back(page_size);
+    }
+
+    std::vector<std::span<State<N>>> v_res_spans(n_ic);
+    std::vector<std::span<State<N>>> v_der_spans(dense_output ? n_ic : 0);
+    std::vector<double> v_tail_errs(n_ic, 0);
 
-    for (auto& t : threads) {
-        if (t.joinable()) {
-            t.join();
+    const size_t chunk = std::max<size_t>(1, n_ic / (4 * ex.size()));
+    ex.parallel_for(priority, n_ic, chunk, [&](size_t begin, size_t end) {
+        std::unique_ptr<BaseStepper<ModelType>> stepper(
+            _make_stepper<ModelType>());
+        const size_t w = ex.worker_index();
+        for (size_t j = begin; j < end; j++) {
+            SFT_TRACE_SPAN("sim", "integrate", j);
+            ModelType h = batch(j);
+            v_res_spans[j] = _run_arena(h, v_S0[j], arenas[w],
+                                        stepper.get(), &v_tail_errs[j]);
+            if (dense_output) {
+                v_der_spans[j] = _derivatives(h, v_res_spans[j], d_arenas[w]);
+            }
         }
+    });
+
+    Results<N> results(_collect_pages(arenas), v_res_spans);
+    results.setTailErrors(std::move(v_tail_errs));
+    if (dense_output) {
+        results.setDerivatives(_collect_pages(d_arenas),
+                               std::move(v_der_spans));
     }
-    for (size_t i = 0; i < N_THREADS; i++) {
-        delete stepper[i];  // Clean steppers
+    return results;
+}
+
+template <typename Sweep, typename ModelType, size_t N>
+std::vector<State<N>> Simulation::run_parallel_sweep(
+    const Sweep& sweep, size_t chunk, std::vector<double>* tail_err) {
+    static_assert(std::is_base_of<Model<N>, ModelType>::value,
+                  "ModelType must be derived from Model");
+    SFT_TRACE_SPAN("sim", "run_parallel_sweep");
+
+    const size_t n_ic = sweep.size();
+    std::vector<State<N>> last(n_ic);
+    if (tail_err) {
+        tail_err->assign(n_ic, 0);
     }
-    delete[] stepper;  // Clean stepper
-    return Results(res, v_res_spans);
+    Executor::shared().parallel_for(
+        priority, n_ic, chunk, [&](size_t begin, size_t end) {
+            std::unique_ptr<BaseStepper<ModelType>> stepper(
+                _make_stepper<ModelType>());
+            for (size_t j = begin; j < end; j++) {
+                SFT_TRACE_SPAN("sim", "integrate", j);
+                auto [h, S0] = sweep.at(j);
+                last[j] = _run_end(h, S0, stepper.get(),
+                                   tail_err ? &(*tail_err)[j] : nullptr);
+            }
+        });
+    return last;
+}
+
+template <typename Sweep, typename ModelType, size_t N>
+SampledResults<N> Simulation::run_parallel_sweep(const Sweep& sweep,
+                                                 const SampleEvents& events,
+                                                 size_t chunk) {
+    static_assert(std::is_base_of<Model<N>, ModelType>::value,
+                  "ModelType must be derived from Model");
+
+    const size_t n_ic = sweep.size();
+    SampledResults<N> results(events, n_ic);
+    Executor::shared().parallel_for(
+        priority, n_ic, chunk, [&](size_t begin, size_t end) {
+            std::unique_ptr<BaseStepper<ModelType>> stepper(
+                _make_stepper<ModelType>());
+            for (size_t j = begin; j < end; j++) {
+                auto [h, S0] = sweep.at(j);
+                _run_sampled(h, S0, stepper.get(), events, results.record(j),
+                             results.flags(j));
+            }
+        });
+    return results;
 }
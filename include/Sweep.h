@@ -0,0 +1,84 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+#include "BallisticModel.h"
+#include "State.h"
+
+/**
+ * @brief Evenly spaced values lo, ..., hi of one sweep axis.
+ *
+ */
+struct SweepAxis {
+    double lo = 0;
+    double hi = 0;
+    size_t n = 1;
+
+    double at(size_t i) const {
+        return n == 1 ? lo : lo + (hi - lo) * double(i) / double(n - 1);
+    }
+};
+
+/**
+ * @brief Cartesian sweep of drop conditions, generated lazily by index.
+ *
+ * The combinations are never stored: at(idx) decodes the flat index in mixed
+ * radix (row-major, mass is the fastest axis) and builds the model and the
+ * release state of that combination. Any thread can therefore work on any
+ * range of indices, see Simulation::run_parallel_sweep.
+ */
+struct DropSweep {
+    enum Axis { H, V, HEADING, WIND_SPEED, WIND_HEAD, MASS, N_AXES };
+
+    std::array<SweepAxis, N_AXES> axes; /**< h (m), V (m/s), heading (rad),
+                                           wind speed (m/s), wind heading
+                                           (rad), mass (kg) */
+    double v_down = 0;                  /**< Release vertical speed (m/s) */
+    double cds = 0;                     /**< Canopy CdS (m^2) */
+    double t_open = 1;                  /**< Canopy opening time (s) */
+
+    size_t size() const {
+        size_t n = 1;
+        for (const auto& ax : axes) {
+            n *= ax.n;
+        }
+        return n;
+    }
+
+    std::array<size_t, N_AXES> shape() const {
+        std::array<size_t, N_AXES> s;
+        for (size_t i = 0; i < N_AXES; i++) {
+            s[i] = axes[i].n;
+        }
+        return s;
+    }
+
+    // Value of every axis for the flat index idx
+    std::array<double, N_AXES> values(size_t idx) const {
+        if (idx >= size()) {
+            throw std::out_of_range("Sweep index out of range");
+        }
+        std::array<double, N_AXES> val;
+        for (size_t i = N_AXES; i-- > 0;) {
+            val[i] = axes[i].at(idx % axes[i].n);
+            idx /= axes[i].n;
+        }
+        return val;
+    }
+
+    std::pair<FixedBallisticModel, State<3>> at(size_t idx) const {
+        auto val = values(idx);
+        VReal3 wind{val[WIND_SPEED] * cos(val[WIND_HEAD]),
+                    val[WIND_SPEED] * sin(val[WIND_HEAD]), 0};
+        State<3> S0{0,
+                    0,
+                    -val[H],
+                    val[V] * cos(val[HEADING]),
+                    val[V] * sin(val[HEADING]),
+                    v_down};
+        return {FixedBallisticModel(val[MASS], cds, wind, t_open), S0};
+    }
+};
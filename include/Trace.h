@@ -0,0 +1,251 @@
+#pragma once
+
+/**
+ * Timeline of the parallel runs in the Chrome trace event format, to open
+ * in Perfetto (ui.perfetto.dev) or chrome://tracing.
+ *
+ * Tracing is compiled in with the SFT_TRACE macro (CMake option SFT_TRACE,
+ * OFF by default); without it SFT_TRACE_SPAN expands to nothing and no
+ * code or data of this file is built. With it, a span costs two clock
+ * reads and a store in a buffer of the calling thread while the tracer is
+ * on, and a relaxed load when it is off.
+ *
+ *     SFT_TRACE_SPAN("sim", "integrate", j);  // Until the end of the scope
+ */
+
+#ifdef SFT_TRACE
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief A complete span, "X" event of the trace.
+ */
+struct TraceEvent {
+    const char* cat;   /**< Category, a string literal */
+    const char* name;  /**< Name, a string literal */
+    int64_t begin_ns;  /**< Since the tracer epoch */
+    int64_t dur_ns;
+    int64_t arg;       /**< e.g. the index of the initial condition, -1 = none */
+};
+
+/**
+ * @brief Events of one thread, in fixed size blocks that never move.
+ *
+ * Only its thread writes to it; the Tracer reads it once the traced work
+ * is over.
+ */
+class TraceBuffer {
+   public:
+    static constexpr size_t BLOCK = 4096;
+
+    explicit TraceBuffer(uint32_t tid) : tid(tid) {}
+
+    void push(const TraceEvent& e) {
+        if (n == BLOCK || blocks.empty()) {
+            blocks.push_back(std::make_unique<TraceEvent[]>(BLOCK));
+            n = 0;
+        }
+        blocks.back()[n++] = e;
+    }
+
+    template <typename F>
+    void for_each(F&& f) const {
+        for (size_t b = 0; b < blocks.size(); b++) {
+            size_t end = b + 1 == blocks.size() ? n : BLOCK;
+            for (size_t i = 0; i < end; i++) f(blocks[b][i]);
+        }
+    }
+
+    void clear() {
+        blocks.clear();
+        n = 0;
+    }
+
+    bool empty() const { return blocks.empty(); }
+
+    const uint32_t tid;
+
+   private:
+    std::vector<std::unique_ptr<TraceEvent[]>> blocks;
+    size_t n = 0;  // Events in the last block
+};
+
+/**
+ * @brief Registry of the per thread buffers and the on/off switch.
+ *
+ * A thread takes a buffer at its first span, under the only lock of the
+ * tracer, and hands it back when it exits. Buffers keep their events until
+ * clear() and are handed out again, lowest track first, so short lived
+ * threads, e.g. the connections of the drop server, share the same tracks
+ * rather than adding new ones each.
+ *
+ * The buffers are written by their threads without the lock: start(),
+ * clear() and write_json() must not overlap traced work, i.e. call them
+ * between the simulations, never while a sweep is running on other
+ * threads.
+ */
+class Tracer {
+   public:
+    static Tracer& get() {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    bool enabled() const { return on.load(std::memory_order_relaxed); }
+
+    // Starts recording, from an empty timeline, no span may be in progress
+    void start() {
+        clear();
+        epoch_ns.store(clock_ns());
+        on.store(true);
+    }
+
+    void stop() { on.store(false); }
+
+    // Drops the events, no span may be in progress
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& b : buffers) b->clear();
+    }
+
+    int64_t now_ns() const {
+        return clock_ns() - epoch_ns.load(std::memory_order_relaxed);
+    }
+
+    // Buffer of the calling thread
+    TraceBuffer& local() {
+        thread_local Slot slot;
+        if (!slot.buf) slot.buf = acquire();
+        return *slot.buf;
+    }
+
+    /**
+     * @brief Writes the events as Chrome trace JSON, once the traced work
+     * is over.
+     *
+     * @return Number of events written, -1 if the file cannot be written.
+     */
+    int64_t write_json(const std::string& path) const {
+        std::FILE* f = std::fopen(path.c_str(), "w");
+        if (!f) return -1;
+        std::lock_guard<std::mutex> lock(mutex);
+        int64_t count = 0;
+        std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", f);
+        for (const auto& b : buffers) {
+            if (b->empty()) continue;  // No track for idle threads
+            std::fprintf(f,
+                         "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                         "\"tid\":%u,\"args\":{\"name\":\"worker %u\"}}",
+                         count ? ",\n" : "", b->tid, b->tid);
+            count++;
+            b->for_each([&](const TraceEvent& e) {
+                std::fprintf(f,
+                             ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\","
+                             "\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u",
+                             e.name, e.cat, e.begin_ns / 1e3, e.dur_ns / 1e3,
+                             b->tid);
+                if (e.arg >= 0) {
+                    std::fprintf(f, ",\"args\":{\"i\":%lld}",
+                                 (long long)e.arg);
+                }
+                std::fputs("}", f);
+                count++;
+            });
+        }
+        std::fputs("\n]}\n", f);
+        bool ok = std::fclose(f) == 0;
+        return ok ? count : -1;
+    }
+
+   private:
+    // Gives the buffer of a thread back when the thread exits
+    struct Slot {
+        TraceBuffer* buf = nullptr;
+        ~Slot() {
+            if (buf) Tracer::get().release(buf);
+        }
+    };
+
+    Tracer() : epoch_ns(clock_ns()) {}
+
+    static int64_t clock_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    TraceBuffer* acquire() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!idle.empty()) {
+            auto it = std::min_element(
+                idle.begin(), idle.end(),
+                [](TraceBuffer* a, TraceBuffer* b) { return a->tid < b->tid; });
+            TraceBuffer* buf = *it;
+            idle.erase(it);
+            return buf;
+        }
+        buffers.push_back(
+            std::make_unique<TraceBuffer>(uint32_t(buffers.size())));
+        return buffers.back().get();
+    }
+
+    void release(TraceBuffer* buf) {
+        std::lock_guard<std::mutex> lock(mutex);
+        idle.push_back(buf);
+    }
+
+    std::atomic<bool> on{false};
+    std::atomic<int64_t> epoch_ns;   // Start of the timeline, steady clock
+    mutable std::mutex mutex;        // Buffers, clear and dump
+    std::vector<std::unique_ptr<TraceBuffer>> buffers;
+    std::vector<TraceBuffer*> idle;  // Of exited threads, to hand out again
+};
+
+/**
+ * @brief Records its lifetime as a span, see SFT_TRACE_SPAN.
+ */
+class TraceSpan {
+   public:
+    TraceSpan(const char* cat, const char* name, int64_t arg = -1) {
+        Tracer& t = Tracer::get();
+        if (t.enabled()) {
+            e = {cat, name, t.now_ns(), 0, arg};
+            active = true;
+        }
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+    ~TraceSpan() {
+        Tracer& t = Tracer::get();
+        if (!active || !t.enabled()) return;  // Ended after stop(), dropped
+        e.dur_ns = t.now_ns() - e.begin_ns;
+        t.local().push(e);
+    }
+
+   private:
+    TraceEvent e;
+    bool active = false;
+};
+
+#define SFT_TRACE_CONCAT_(a, b) a##b
+#define SFT_TRACE_CONCAT(a, b) SFT_TRACE_CONCAT_(a, b)
+#define SFT_TRACE_SPAN(...) \
+    TraceSpan SFT_TRACE_CONCAT(sft_trace_span_, __LINE__)(__VA_ARGS__)
+
+#else
+
+#define SFT_TRACE_SPAN(...) \
+    do {                    \
+    } while (0)
+
+#endif
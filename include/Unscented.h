@@ -0,0 +1,182 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "BallisticModel.h"
+#include "Dispersion.h"
+#include "Simulation.h"
+#include "State.h"
+
+/**
+ * @brief Gaussian distribution of the uncertain drop inputs.
+ *
+ * The release altitude is known, the inputs are the wind and the release
+ * velocity (NED, m/s), the canopy CdS (m^2) and the payload mass (kg).
+ */
+struct DropDistribution {
+    enum Input { WIND_N, WIND_E, CDS, MASS, VEL_N, VEL_E, VEL_D, N_INPUTS };
+    using Vector = std::array<double, N_INPUTS>;
+
+    Vector mean{};
+    std::array<Vector, N_INPUTS> cov{}; /**< Covariance, symmetric */
+    double h = 0;                       /**< Release altitude (m) */
+    double t_open = 1;                  /**< Canopy opening time (s) */
+
+    /**
+     * @brief Lower triangular L with L L^T = cov.
+     *
+     * Semi-definite covariances (inputs without uncertainty) are accepted,
+     * the columns of the null directions are left to zero.
+     */
+    std::array<Vector, N_INPUTS> cholesky() const {
+        std::array<Vector, N_INPUTS> L{};
+        for (size_t j = 0; j < N_INPUTS; j++) {
+            double d = cov[j][j];
+            for (size_t k = 0; k < j; k++) {
+                d -= L[j][k] * L[j][k];
+            }
+            if (d < -1e-12 * (1 + cov[j][j])) {
+                throw std::invalid_argument("Covariance not positive");
+            }
+            L[j][j] = d > 0 ? std::sqrt(d) : 0;
+            for (size_t i = j + 1; i < N_INPUTS; i++) {
+                double v = cov[i][j];
+                for (size_t k = 0; k < j; k++) {
+                    v -= L[i][k] * L[j][k];
+                }
+                L[i][j] = L[j][j] > 0 ? v / L[j][j] : 0;
+            }
+        }
+        return L;
+    }
+
+    // Model and release state of the drop with inputs x
+    std::pair<FixedBallisticModel, State<3>> drop(const Vector& x) const {
+        State<3> S0{0, 0, -h, x[VEL_N], x[VEL_E], x[VEL_D]};
+        return {FixedBallisticModel(x[MASS], x[CDS],
+                                    VReal3{x[WIND_N], x[WIND_E], 0}, t_open),
+                S0};
+    }
+};
+
+/**
+ * @brief Drops at explicit input vectors, in the sweep interface of
+ * Simulation::run_parallel_sweep. The release is above the origin.
+ */
+struct InputSweep {
+    const DropDistribution& dist;
+    std::vector<DropDistribution::Vector> points;
+
+    size_t size() const { return points.size(); }
+
+    std::pair<FixedBallisticModel, State<3>> at(size_t idx) const {
+        return dist.drop(points[idx]);
+    }
+};
+
+/**
+ * @brief Landing mean and covariance by the unscented transform.
+ *
+ * The 2n+1 sigma points mean +- sqrt((n + lambda) P) columns, with
+ * lambda = alpha^2 (n + kappa) - n, are dropped in one parallel sweep and
+ * their landings recombined with the scaled UT weights. With the defaults
+ * (alpha = 1, beta = 2, kappa = 0) the center point only enters the
+ * covariance. For the 7 inputs of DropDistribution it costs 15 runs.
+ *
+ * @param sim Simulation settings (integrator, dt, T).
+ * @param dist Distribution of the inputs.
+ */
+inline LandingSpread unscented_landing(Simulation& sim,
+                                       const DropDistribution& dist,
+                                       double alpha = 1, double beta = 2,
+                                       double kappa = 0) {
+    const size_t n = DropDistribution::N_INPUTS;
+    const double lambda = alpha * alpha * (n + kappa) - double(n);
+    if (n + lambda <= 0) {
+        throw std::invalid_argument("UT parameters give n + lambda <= 0");
+    }
+    auto L = dist.cholesky();
+    double scale = std::sqrt(n + lambda);
+
+    InputSweep sweep{dist, {dist.mean}};
+    for (size_t j = 0; j < n; j++) {
+        for (double sign : {1.0, -1.0}) {
+            DropDistribution::Vector x = dist.mean;
+            for (size_t i = j; i < n; i++) {
+                x[i] += sign * scale * L[i][j];
+            }
+            sweep.points.push_back(x);
+        }
+    }
+    std::vector<State<3>> last = sim.run_parallel_sweep(sweep, 1);
+
+    const double w0_m = lambda / (n + lambda);
+    const double w0_c = w0_m + 1 - alpha * alpha + beta;
+    const double wi = 0.5 / (n + lambda);
+    LandingSpread spread;
+    spread.n = w0_m * last[0].X()[0];
+    spread.e = w0_m * last[0].X()[1];
+    for (size_t k = 1; k < last.size(); k++) {
+        spread.n += wi * last[k].X()[0];
+        spread.e += wi * last[k].X()[1];
+    }
+    for (size_t k = 0; k < last.size(); k++) {
+        spread.add(k == 0 ? w0_c : wi, last[k].X()[0] - spread.n,
+                   last[k].X()[1] - spread.e);
+    }
+    return spread;
+}
+
+/**
+ * @brief Landing mean and covariance by plain Monte Carlo, reference for
+ * unscented_landing.
+ *
+ * @param sim Simulation settings (integrator, dt, T).
+ * @param dist Distribution of the inputs.
+ * @param n_samples Number of drops.
+ * @param seed Seed of the normal samples.
+ */
+inline LandingSpread monte_carlo_landing(Simulation& sim,
+                                         const DropDistribution& dist,
+                                         size_t n_samples,
+                                         unsigned seed = 0) {
+    const size_t n = DropDistribution::N_INPUTS;
+    if (n_samples < 2) {
+        throw std::invalid_argument("Monte Carlo needs at least 2 samples");
+    }
+    auto L = dist.cholesky();
+    std::mt19937_64 gen(seed);
+    std::normal_distribution<double> normal;
+
+    InputSweep sweep{dist, {}};
+    sweep.points.reserve(n_samples);
+    for (size_t s = 0; s < n_samples; s++) {
+        DropDistribution::Vector z, x = dist.mean;
+        for (auto& v : z) {
+            v = normal(gen);
+        }
+        for (size_t i = 0; i < n; i++) {
+            for (size_t j = 0; j <= i; j++) {
+                x[i] += L[i][j] * z[j];
+            }
+        }
+        sweep.points.push_back(x);
+    }
+    std::vector<State<3>> last = sim.run_parallel_sweep(sweep);
+
+    LandingSpread spread;
+    for (const auto& S : last) {
+        spread.n += S.X()[0] / n_samples;
+        spread.e += S.X()[1] / n_samples;
+    }
+    for (const auto& S : last) {
+        spread.add(1.0 / (n_samples - 1), S.X()[0] - spread.n,
+                   S.X()[1] - spread.e);
+    }
+    return spread;
+}
@@ -201,7 +201,7 @@ class VReal : boost::additive1<
         return res;
     }
 
-    double mod() {
+    double mod() const {
         double res = 0;
         for (size_t i = 0; i < N; i++) {
             res += v[i] * v[i];
@@ -212,6 +212,9 @@ class VReal : boost::additive1<
     double& operator[](size_t i) {
         return v[i];
     }
+    double operator[](size_t i) const {
+        return v[i];
+    }
 
     // Function to return an std::array copy of the data
     std::array<double, N> data() const {
@@ -1,5 +1,6 @@
 #pragma once
 #include <cmath>
+#include <cstddef>
 #include <vector>
 
 #include "../include/State.h"
@@ -51,4 +52,78 @@ GPS get_drop(const State<N> S_end, const GPS &gps_target);
  * @return A vector of GPS coordinates that are d meters away from the starting
  * point in the specified heading direction.
  */
-std::vector<GPS> way_array(const GPS &drop, double heading, double d);
\ No newline at end of file
+std::vector<GPS> way_array(const GPS &drop, double heading, double d);
+
+/*
+ * Batch versions. Points are passed as structure of arrays (one array per
+ * coordinate), output arrays must hold n values and may alias the inputs of
+ * the same coordinate. The loops are branch free so that the compiler can
+ * vectorize them.
+ */
+
+/**
+ * Sine and cosine of n angles (rad), accurate to a few ulp for |x| < 1e5.
+ * Argument reduction by pi/2 and the polynomials of Cephes sin.c, without
+ * the branches of the libm version.
+ *
+ * @param x The angles (rad).
+ * @param n Number of angles.
+ * @param s Sine of the angles.
+ * @param c Cosine of the angles.
+ */
+void sincos_batch(const double *x, size_t n, double *s, double *c);
+
+/**
+ * Local tangent frame (north, east) of a target. The trig of the target
+ * latitude is computed once, so converting many points around the same target
+ * costs a few multiplications each. Same flat earth approximation of
+ * get_drop, good to a few cm within a few km of the target.
+ */
+struct GeoFrame {
+    GPS origin;
+    double sin_lat = 0;   // sin of the origin latitude
+    double cos_lat = 1;   // cos of the origin latitude
+    double m2lat = 0;     // degrees of latitude per meter north
+    double m2lon = 0;     // degrees of longitude per meter east
+
+    GeoFrame() {}
+    explicit GeoFrame(const GPS &origin);
+
+    // Points at (north, east) meters from the origin
+    void to_gps(const double *north, const double *east, size_t n,
+                double *lat, double *lon) const;
+    // Offsets (north, east) in meters of points from the origin
+    void to_enu(const double *lat, const double *lon, size_t n, double *north,
+                double *east) const;
+    // Great circle translation of the origin by d[i] meters along head[i]
+    // (rad), as translate_gps
+    void translate(const double *d, const double *head, size_t n, double *lat,
+                   double *lon) const;
+};
+
+/**
+ * Batch translate_gps: point i is moved by d[i] meters along head[i] (rad).
+ */
+void translate_gps_batch(const double *lat, const double *lon, const double *d,
+                         const double *head, size_t n, double *lat_out,
+                         double *lon_out);
+
+/**
+ * Batch get_drop: drop points of n landings (north[i], east[i]) relative to
+ * the release, for the same target.
+ */
+void get_drop_batch(const GeoFrame &target, const double *north,
+                    const double *east, size_t n, double *lat, double *lon);
+
+/**
+ * Batch way_array: out[6*i + 2*k + {0, 1}] is the {lat, lon} of the k-th
+ * waypoint (first, drop, last) of the i-th drop point, with heading[i] in rad.
+ *
+ * @throws std::invalid_argument if d is equal to 0.
+ */
+void way_array_batch(const double *lat, const double *lon,
+                     const double *heading, size_t n, double d, double *out);
+
+void dms2gps_batch(const DMS *dms, size_t n, double *lat, double *lon);
+
+void gps2dms_batch(const double *lat, const double *lon, size_t n, DMS *dms);
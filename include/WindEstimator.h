@@ -0,0 +1,215 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+#include "State.h"
+#include "VReal.h"
+#include "Wind.h"
+
+/**
+ * @brief One air data sample of the UAV.
+ */
+struct AirData {
+    double stamp = 0;            /**< Time of the sample (s), any clock */
+    double h = 0;                /**< Altitude above the target (m) */
+    double airspeed = 0;         /**< True airspeed (m/s) */
+    double heading = 0;          /**< Heading (rad), 0 = north, pi/2 = east */
+    double vel_n = 0, vel_e = 0; /**< Ground velocity (m/s) */
+};
+
+/**
+ * @brief Settings of the WindEstimator, 1-sigma values.
+ */
+struct WindEstimatorConfig {
+    double sigma_wind = 5;     /**< Wind uncertainty before any sample */
+    double q_wind = 0.05;      /**< Wind random walk (m/s / sqrt(s)) */
+    bool shear = false;        /**< Estimate a linear shear with altitude */
+    double sigma_shear = 0.05; /**< Initial shear uncertainty (m/s / m) */
+    double q_shear = 1e-4;     /**< Shear random walk (m/s / m / sqrt(s)) */
+    double r_vel = 0.5;        /**< Error of ground minus air velocity (m/s) */
+    /** Samples with a squared normalized innovation above this are
+     * rejected, 0 = accept everything. 13.8 is the 99.9% of a chi2(2). */
+    double gate = 13.8;
+    /** After this many rejections in a row the wind is taken to have
+     * really changed and the filter restarts from the sample, 0 = never
+     * restart */
+    uint32_t max_rejects = 10;
+};
+
+/**
+ * @brief Kalman filter of the horizontal wind from air data.
+ *
+ * The state is the wind at the reference altitude h_ref and, with shear
+ * set, its gradient with altitude:
+ *
+ *     x = {w_n, w_e, s_n, s_e},  wind(h) = w + s (h - h_ref)
+ *
+ * Each sample measures ground velocity minus air velocity, i.e. the wind
+ * at the altitude of the UAV, and the states follow a random walk between
+ * samples. Without shear the gradient starts and stays at zero with zero
+ * covariance, so the same 4 states serve both cases. The filter starts
+ * from the first sample, whose altitude is h_ref, and restarts the same
+ * way after max_rejects gated samples in a row. The shear is observable
+ * only once the UAV changes altitude, until then it stays at its prior.
+ *
+ * Everything is fixed size, a sample costs a few hundred flops and no
+ * allocation, and the estimator is a plain value that can be copied to
+ * hand a snapshot to another thread.
+ */
+class WindEstimator {
+   public:
+    static constexpr size_t N_STATES = 4;
+    using Matrix = std::array<std::array<double, N_STATES>, N_STATES>;
+
+    explicit WindEstimator(const WindEstimatorConfig& cfg = {}) : cfg(cfg) {
+        reset();
+    }
+
+    // Back to the prior, no sample seen
+    void reset() {
+        x = {};
+        P = {};
+        P[0][0] = P[1][1] = cfg.sigma_wind * cfg.sigma_wind;
+        if (cfg.shear) P[2][2] = P[3][3] = cfg.sigma_shear * cfg.sigma_shear;
+        n_samples = n_rejected = 0;
+        n_consecutive = 0;
+    }
+
+    /**
+     * @brief Propagates the estimate to the sample time and corrects it.
+     *
+     * @return false if the sample was rejected by the gate, the estimate is
+     * then only propagated.
+     */
+    bool update(const AirData& a) {
+        // Measured wind, z = v_ground - v_air
+        const double z_n = a.vel_n - a.airspeed * std::cos(a.heading);
+        const double z_e = a.vel_e - a.airspeed * std::sin(a.heading);
+        if (n_samples == 0 ||
+            (cfg.max_rejects > 0 && n_consecutive >= cfg.max_rejects)) {
+            restart(a, z_n, z_e);
+            return true;
+        }
+        predict(std::max(0.0, a.stamp - t_last));
+        t_last = a.stamp;
+
+        // Innovation, H = [I, (h - h_ref) I]
+        const double dh = cfg.shear ? a.h - h_ref : 0;
+        const double y_n = z_n - (x[0] + dh * x[2]);
+        const double y_e = z_e - (x[1] + dh * x[3]);
+
+        // P H^T, a 4x2 matrix
+        std::array<double, N_STATES> PHn, PHe;
+        for (size_t i = 0; i < N_STATES; i++) {
+            PHn[i] = P[i][0] + dh * P[i][2];
+            PHe[i] = P[i][1] + dh * P[i][3];
+        }
+        // S = H P H^T + R and its inverse, 2x2
+        const double r = cfg.r_vel * cfg.r_vel;
+        const double s_nn = PHn[0] + dh * PHn[2] + r;
+        const double s_ne = PHe[0] + dh * PHe[2];
+        const double s_ee = PHe[1] + dh * PHe[3] + r;
+        const double det = s_nn * s_ee - s_ne * s_ne;
+        if (!(det > 0)) return reject();
+        const double i_nn = s_ee / det, i_ne = -s_ne / det, i_ee = s_nn / det;
+
+        const double d2 =
+            y_n * (i_nn * y_n + i_ne * y_e) + y_e * (i_ne * y_n + i_ee * y_e);
+        if (cfg.gate > 0 && d2 > cfg.gate) return reject();
+        last_d2 = d2;
+
+        // K = P H^T S^-1, x += K y, P -= K H P kept symmetric
+        std::array<double, N_STATES> Kn, Ke;
+        for (size_t i = 0; i < N_STATES; i++) {
+            Kn[i] = PHn[i] * i_nn + PHe[i] * i_ne;
+            Ke[i] = PHn[i] * i_ne + PHe[i] * i_ee;
+            x[i] += Kn[i] * y_n + Ke[i] * y_e;
+        }
+        for (size_t i = 0; i < N_STATES; i++) {
+            for (size_t j = i; j < N_STATES; j++) {
+                P[i][j] -= Kn[i] * PHn[j] + Ke[i] * PHe[j];
+                P[j][i] = P[i][j];
+            }
+        }
+        n_samples++;
+        n_consecutive = 0;
+        return true;
+    }
+
+    // Estimated wind at altitude h (m), NED with no vertical component
+    VReal3 wind(double h) const {
+        const double dh = cfg.shear ? h - h_ref : 0;
+        return VReal3{x[0] + dh * x[2], x[1] + dh * x[3], 0};
+    }
+
+    // Variances of the north and east wind at altitude h (m^2/s^2)
+    std::array<double, 2> variance(double h) const {
+        const double dh = cfg.shear ? h - h_ref : 0;
+        return {P[0][0] + 2 * dh * P[0][2] + dh * dh * P[2][2],
+                P[1][1] + 2 * dh * P[1][3] + dh * dh * P[3][3]};
+    }
+
+    // Shear (m/s per m of altitude), zero without shear
+    std::array<double, 2> shear() const { return {x[2], x[3]}; }
+
+    /**
+     * @brief Wind law of the current estimate, for BallisticModel.
+     *
+     * A snapshot: later updates do not change it. The altitude is -z of
+     * the position, as in the simulations.
+     */
+    Wind<3> law() const {
+        const WindEstimator snap = *this;
+        return Wind<3>([snap](const State<3>&, const VReal3& X, double) {
+            return snap.wind(-X[2]);
+        });
+    }
+
+    const std::array<double, N_STATES>& state() const { return x; }
+    const Matrix& covariance() const { return P; }
+    double reference_altitude() const { return h_ref; }
+    double last_innovation() const { return last_d2; }
+    uint64_t samples() const { return n_samples; }
+    uint64_t rejected() const { return n_rejected; }
+
+   private:
+    // Random walk over dt seconds
+    void predict(double dt) {
+        P[0][0] += cfg.q_wind * cfg.q_wind * dt;
+        P[1][1] += cfg.q_wind * cfg.q_wind * dt;
+        if (cfg.shear) {
+            P[2][2] += cfg.q_shear * cfg.q_shear * dt;
+            P[3][3] += cfg.q_shear * cfg.q_shear * dt;
+        }
+    }
+
+    bool reject() {
+        n_rejected++;
+        n_consecutive++;
+        return false;
+    }
+
+    // Prior around the measured wind, at the altitude of the sample
+    void restart(const AirData& a, double z_n, double z_e) {
+        uint64_t n = n_samples, r = n_rejected;
+        reset();
+        n_samples = n + 1;
+        n_rejected = r;
+        x[0] = z_n;
+        x[1] = z_e;
+        P[0][0] = P[1][1] = cfg.r_vel * cfg.r_vel;
+        h_ref = a.h;
+        t_last = a.stamp;
+        last_d2 = 0;
+    }
+
+    WindEstimatorConfig cfg;
+    std::array<double, N_STATES> x;
+    Matrix P;
+    double h_ref = 0, t_last = 0, last_d2 = 0;
+    uint64_t n_samples = 0, n_rejected = 0;
+    uint32_t n_consecutive = 0;  // Rejections since the last update
+};
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "BallisticModel.h"
+#include "Dispersion.h"
+#include "Sampling.h"
+#include "Simulation.h"
+#include "State.h"
+
+/**
+ * @brief A logged drop: release conditions and observed landing.
+ */
+struct RecordedDrop {
+    double h = 0;                   /**< Release altitude above the landing (m) */
+    double vel_n = 0, vel_e = 0;    /**< Release velocity (m/s) */
+    double vel_d = 0;               /**< Vertical velocity (m/s), NED */
+    double mass = 1;                /**< Payload mass (kg) */
+    double land_n = 0, land_e = 0;  /**< Landing relative to the release (m) */
+    double wind_n = 0, wind_e = 0;  /**< Reported wind, first guess (m/s) */
+};
+
+/**
+ * @brief Wind that explains a logged landing.
+ */
+struct WindFit {
+    double wind_n = 0, wind_e = 0;       /**< Effective wind (m/s) */
+    double c_nn = 0, c_ne = 0, c_ee = 0; /**< Its covariance (m^2/s^2) */
+    double residual = 0;    /**< Distance of the model landing from the log (m) */
+    unsigned iterations = 0;
+    bool converged = false; /**< Residual below tol, false if it never landed */
+};
+
+/**
+ * @brief Settings of invert_winds.
+ */
+struct WindInversionOptions {
+    double cds = 0.3;       /**< Calibrated canopy CdS (m^2) */
+    double t_open = 1;      /**< Canopy opening time (s) */
+    double sigma_land = 2;  /**< 1-sigma of the logged landing (m) */
+    double delta = 0.5;     /**< Finite difference step of the wind (m/s) */
+    double tol = 0.01;      /**< Landing residual to stop at (m) */
+    double max_step = 10;   /**< Largest wind change per iteration (m/s) */
+    unsigned max_iter = 10;
+};
+
+/**
+ * @brief Drops of one Gauss-Newton iteration, in the sweep interface of
+ * Simulation::run_parallel_sweep.
+ *
+ * Three runs per active flight, at its current wind and with the north and
+ * east wind moved by delta.
+ */
+struct WindFitSweep {
+    const std::vector<RecordedDrop>& drops;
+    const std::vector<WindFit>& fits;
+    const std::vector<size_t>& active;
+    const WindInversionOptions& opt;
+
+    size_t size() const { return 3 * active.size(); }
+
+    std::pair<FixedBallisticModel, State<3>> at(size_t idx) const {
+        size_t i = active[idx / 3], k = idx % 3;
+        const RecordedDrop& d = drops[i];
+        VReal3 wind{fits[i].wind_n + (k == 1 ? opt.delta : 0),
+                    fits[i].wind_e + (k == 2 ? opt.delta : 0), 0};
+        return {FixedBallisticModel(d.mass, opt.cds, wind, opt.t_open),
+                State<3>{0, 0, -d.h, d.vel_n, d.vel_e, d.vel_d}};
+    }
+};
+
+/**
+ * @brief Effective wind of each logged flight, given the CdS.
+ *
+ * Gauss-Newton on the landing residual, from the reported wind, with the
+ * 2x2 Jacobian by forward differences. The iterations of all the flights
+ * not converged yet are run together as one parallel sweep, 3 runs per
+ * flight. The landing is close to linear in the wind, 2 or 3 iterations
+ * are usually enough.
+ *
+ * The covariance of a fit is sigma_land^2 (J^T J)^-1, the wind error that
+ * the landing error alone explains.
+ *
+ * @param sim Simulation settings (integrator, dt, T, priority).
+ * @param drops The logged flights.
+ * @param opt CdS and solver settings.
+ */
+inline std::vector<WindFit> invert_winds(Simulation& sim,
+                                         const std::vector<RecordedDrop>& drops,
+                                         const WindInversionOptions& opt) {
+    const double T = sim.get_time_interval(), dt = sim.get_time_step();
+    std::vector<WindFit> fits(drops.size());
+    std::vector<size_t> active;
+    for (size_t i = 0; i < drops.size(); i++) {
+        fits[i].wind_n = drops[i].wind_n;
+        fits[i].wind_e = drops[i].wind_e;
+        active.push_back(i);
+    }
+
+    for (unsigned it = 0; it <= opt.max_iter && !active.empty(); it++) {
+        WindFitSweep sweep{drops, fits, active, opt};
+        // The landings are interpolated to the ground: the last states
+        // above it move by whole steps as the wind changes, the finite
+        // differences need a landing that is smooth in the wind
+        SampledResults<3> res =
+            sim.run_parallel_sweep(sweep, SampleEvents{}, 3);
+
+        std::vector<size_t> next;
+        for (size_t a = 0; a < active.size(); a++) {
+            const size_t i = active[a];
+            const State<3> S[3] = {res.getImpact(3 * a),
+                                   res.getImpact(3 * a + 1),
+                                   res.getImpact(3 * a + 2)};
+            WindFit& f = fits[i];
+            if (S[0].get_t() + dt >= T) {
+                f.converged = false;  // Still in the air, no landing to fit
+                continue;
+            }
+            const double n0 = S[0].X()[0], e0 = S[0].X()[1];
+            const double n1 = S[1].X()[0], e1 = S[1].X()[1];
+            const double n2 = S[2].X()[0], e2 = S[2].X()[1];
+            const double r_n = drops[i].land_n - n0;
+            const double r_e = drops[i].land_e - e0;
+            // J = d landing / d wind, columns north and east
+            const double j_nn = (n1 - n0) / opt.delta;
+            const double j_en = (e1 - e0) / opt.delta;
+            const double j_ne = (n2 - n0) / opt.delta;
+            const double j_ee = (e2 - e0) / opt.delta;
+            const double det = j_nn * j_ee - j_ne * j_en;
+
+            f.residual = std::hypot(r_n, r_e);
+            f.iterations = it;
+            if (det != 0) {
+                // sigma^2 (J^T J)^-1 = sigma^2 J^-1 J^-T
+                const double s2 = opt.sigma_land * opt.sigma_land / (det * det);
+                f.c_nn = s2 * (j_ee * j_ee + j_ne * j_ne);
+                f.c_ne = -s2 * (j_ee * j_en + j_ne * j_nn);
+                f.c_ee = s2 * (j_en * j_en + j_nn * j_nn);
+            }
+            if (f.residual < opt.tol) {
+                f.converged = true;
+                continue;
+            }
+            if (det == 0 || it == opt.max_iter) continue;
+
+            // Square system, the Gauss-Newton step is J^-1 r
+            double d_n = (j_ee * r_n - j_ne * r_e) / det;
+            double d_e = (-j_en * r_n + j_nn * r_e) / det;
+            const double norm = std::hypot(d_n, d_e);
+            if (norm > opt.max_step) {
+                d_n *= opt.max_step / norm;
+                d_e *= opt.max_step / norm;
+            }
+            f.wind_n += d_n;
+            f.wind_e += d_e;
+            next.push_back(i);
+        }
+        active.swap(next);
+    }
+    return fits;
+}
+
+/**
+ * @brief Mean and covariance of the fitted minus reported wind, over the
+ * converged fits, e.g. the wind uncertainty of DropDistribution.
+ *
+ * The n and e of the result are the mean wind error (m/s), the covariance
+ * is the sample one.
+ */
+inline LandingSpread wind_errors(const std::vector<RecordedDrop>& drops,
+                                 const std::vector<WindFit>& fits) {
+    LandingSpread sp;
+    size_t n = 0;
+    for (size_t i = 0; i < fits.size(); i++) {
+        if (!fits[i].converged) continue;
+        n++;
+        sp.n += fits[i].wind_n - drops[i].wind_n;
+        sp.e += fits[i].wind_e - drops[i].wind_e;
+    }
+    if (n == 0) return sp;
+    sp.n /= n;
+    sp.e /= n;
+    if (n < 2) return sp;
+    for (size_t i = 0; i < fits.size(); i++) {
+        if (!fits[i].converged) continue;
+        sp.add(1.0 / (n - 1), fits[i].wind_n - drops[i].wind_n - sp.n,
+               fits[i].wind_e - drops[i].wind_e - sp.e);
+    }
+    return sp;
+}
@@ -6,4 +6,22 @@
 #include "Settings.h"
 #include "Simulation.h"
 #include "State.h"
-#include "Wind.h"
\ No newline at end of file
+#include "Wind.h"
+#include "AnalyticDrop.h"
+#include "Sweep.h"
+#include "DropWindow.h"
+#include "HeadingPlanner.h"
+#include "Unscented.h"
+#include "QMC.h"
+#include "Sensitivity.h"
+#include "DropCache.h"
+#include "SharedSolution.h"
+#include "Predictor.h"
+#include "Executor.h"
+#include "Anytime.h"
+#include "WindEstimator.h"
+#include "WindInversion.h"
+#include "FlightLog.h"
+#include "Replay.h"
+#include "Autotune.h"
+#include "Trace.h"
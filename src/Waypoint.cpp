@@ -1,5 +1,11 @@
 #include "../include/Waypoint.h"
 
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+static const double R_EARTH = 6378100;  // Earth radius (m)
+
 GPS dms2gps(const DMS &dms) {
     GPS ret;
     for (int i = 0; i < 3; i++) {
@@ -39,7 +45,7 @@ GPS translate_gps(const GPS &gps, double d, double head, bool rad) {
         return gps;
     } else if (d < 0) {
         d = -d;
-        head += 180;
+        head += rad ? M_PI : 180;
     }
     double head_rad;
     if (!rad) {
@@ -128,4 +134,162 @@ std::vector<GPS> way_array(const GPS &drop, double heading, double d) {
     } else {
         throw std::invalid_argument("d must be different from 0");
     }
-}
\ No newline at end of file
+}
+
+void sincos_batch(const double *x, size_t n, double *s, double *c) {
+    // pi/2 split in three parts, so that x - q pi/2 is exact for small q
+    const double pio2_1 = 1.57079632673412561417e+00;
+    const double pio2_2 = 6.07710050630396597660e-11;
+    const double pio2_3 = 2.02226624879595063154e-21;
+    const double shift = 6755399441055744.0;  // 1.5 * 2^52, round to integer
+    for (size_t i = 0; i < n; i++) {
+        double k = (x[i] * M_2_PI + shift) - shift;
+        double r = ((x[i] - k * pio2_1) - k * pio2_2) - k * pio2_3;
+        double z = r * r;
+
+        double ps = 1.58962301576546568060E-10;
+        ps = ps * z - 2.50507477628578072866E-8;
+        ps = ps * z + 2.75573136213857245213E-6;
+        ps = ps * z - 1.98412698295895385996E-4;
+        ps = ps * z + 8.33333333332211858878E-3;
+        ps = ps * z - 1.66666666666666307295E-1;
+        double sr = r + r * z * ps;
+
+        double pc = -1.13585365213876817300E-11;
+        pc = pc * z + 2.08757008419747316778E-9;
+        pc = pc * z - 2.75573141792967388112E-7;
+        pc = pc * z + 2.48015872888517045348E-5;
+        pc = pc * z - 1.38888888888730564116E-3;
+        pc = pc * z + 4.16666666666665929218E-2;
+        double cr = 1 - 0.5 * z + z * z * pc;
+
+        // Quadrant k mod 4 as m in {-2, -1, 0, 1, 2}, kept in double so that
+        // the selects vectorize: swap on odd m, sin < 0 for m = +-2, -1 and
+        // cos < 0 for m = +-2, 1
+        double m = k - 4 * ((k * 0.25 + shift) - shift);
+        double m2 = m * m;
+        double sv = m2 == 1 ? cr : sr;
+        double cv = m2 == 1 ? sr : cr;
+        s[i] = (m2 == 4 || m == -1) ? -sv : sv;
+        c[i] = (m2 == 4 || m == 1) ? -cv : cv;
+    }
+}
+
+GeoFrame::GeoFrame(const GPS &origin) : origin(origin) {
+    double lat_rad = origin.lat * M_PI / 180;
+    sin_lat = sin(lat_rad);
+    cos_lat = cos(lat_rad);
+    m2lat = 180 / (M_PI * R_EARTH);
+    m2lon = 180 / (M_PI * R_EARTH * cos_lat);
+}
+
+void GeoFrame::to_gps(const double *north, const double *east, size_t n,
+                      double *lat, double *lon) const {
+    for (size_t i = 0; i < n; i++) {
+        lat[i] = origin.lat + north[i] * m2lat;
+        lon[i] = origin.lon + east[i] * m2lon;
+    }
+}
+
+void GeoFrame::to_enu(const double *lat, const double *lon, size_t n,
+                      double *north, double *east) const {
+    for (size_t i = 0; i < n; i++) {
+        north[i] = (lat[i] - origin.lat) / m2lat;
+        east[i] = (lon[i] - origin.lon) / m2lon;
+    }
+}
+
+// Great circle step from (sin_lat, cos_lat, lon) by the angles (d / R_E, head)
+// given by their sine and cosine, in place on lat and lon
+static inline void great_circle(double sin_lat, double cos_lat, double lon_deg,
+                                double sin_d, double cos_d, double sin_h,
+                                double cos_h, double &lat, double &lon) {
+    double sin_new = sin_lat * cos_d + cos_lat * sin_d * cos_h;
+    lat = asin(sin_new) * 180 / M_PI;
+    lon = lon_deg + atan2(sin_h * sin_d * cos_lat, cos_d - sin_lat * sin_new) *
+                        180 / M_PI;
+}
+
+void GeoFrame::translate(const double *d, const double *head, size_t n,
+                         double *lat, double *lon) const {
+    std::vector<double> buf(4 * n);
+    double *ang = buf.data(), *sin_d = ang + n, *cos_d = sin_d + n,
+           *sin_h = cos_d + n;
+    for (size_t i = 0; i < n; i++) {
+        ang[i] = d[i] / R_EARTH;
+    }
+    sincos_batch(ang, n, sin_d, cos_d);
+    sincos_batch(head, n, sin_h, ang);  // ang now holds cos(head)
+    for (size_t i = 0; i < n; i++) {
+        great_circle(sin_lat, cos_lat, origin.lon, sin_d[i], cos_d[i],
+                     sin_h[i], ang[i], lat[i], lon[i]);
+    }
+}
+
+void translate_gps_batch(const double *lat, const double *lon, const double *d,
+                         const double *head, size_t n, double *lat_out,
+                         double *lon_out) {
+    std::vector<double> buf(6 * n);
+    double *ang = buf.data(), *sin_d = ang + n, *cos_d = sin_d + n,
+           *sin_h = cos_d + n, *cos_h = sin_h + n, *sin_l = cos_h + n;
+    for (size_t i = 0; i < n; i++) {
+        ang[i] = d[i] / R_EARTH;
+    }
+    sincos_batch(ang, n, sin_d, cos_d);
+    sincos_batch(head, n, sin_h, cos_h);
+    for (size_t i = 0; i < n; i++) {
+        ang[i] = lat[i] * M_PI / 180;
+    }
+    sincos_batch(ang, n, sin_l, ang);  // ang now holds cos(lat)
+    for (size_t i = 0; i < n; i++) {
+        great_circle(sin_l[i], ang[i], lon[i], sin_d[i], cos_d[i], sin_h[i],
+                     cos_h[i], lat_out[i], lon_out[i]);
+    }
+}
+
+void get_drop_batch(const GeoFrame &target, const double *north,
+                    const double *east, size_t n, double *lat, double *lon) {
+    // The drop point is the target moved back by the landing offset
+    for (size_t i = 0; i < n; i++) {
+        lat[i] = target.origin.lat - north[i] * target.m2lat;
+        lon[i] = target.origin.lon - east[i] * target.m2lon;
+    }
+}
+
+void way_array_batch(const double *lat, const double *lon,
+                     const double *heading, size_t n, double d, double *out) {
+    if (d == 0) {
+        throw std::invalid_argument("d must be different from 0");
+    }
+    std::vector<double> buf(6 * n);
+    double *lat_f = buf.data(), *lon_f = lat_f + n,
+           *lat_l = lon_f + n, *lon_l = lat_l + n, *neg = lon_l + n,
+           *pos = neg + n;
+    for (size_t i = 0; i < n; i++) {
+        neg[i] = -d;
+        pos[i] = d;
+    }
+    translate_gps_batch(lat, lon, neg, heading, n, lat_f, lon_f);
+    translate_gps_batch(lat, lon, pos, heading, n, lat_l, lon_l);
+    for (size_t i = 0; i < n; i++) {
+        out[6 * i + 0] = lat_f[i];
+        out[6 * i + 1] = lon_f[i];
+        out[6 * i + 2] = lat[i];
+        out[6 * i + 3] = lon[i];
+        out[6 * i + 4] = lat_l[i];
+        out[6 * i + 5] = lon_l[i];
+    }
+}
+
+void dms2gps_batch(const DMS *dms, size_t n, double *lat, double *lon) {
+    for (size_t i = 0; i < n; i++) {
+        lat[i] = dms[i].N[0] + dms[i].N[1] / 60. + dms[i].N[2] / 3600.;
+        lon[i] = dms[i].E[0] + dms[i].E[1] / 60. + dms[i].E[2] / 3600.;
+    }
+}
+
+void gps2dms_batch(const double *lat, const double *lon, size_t n, DMS *dms) {
+    for (size_t i = 0; i < n; i++) {
+        dms[i] = gps2dms(GPS{lat[i], lon[i]});
+    }
+}
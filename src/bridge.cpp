@@ -1,5 +1,6 @@
 #include "../include/pch.h"
 #include <string>
+#include <memory>
 
 /**
  * Calculates the GPS coordinates of a drop point given the current state,
@@ -27,27 +28,15 @@ GPS get_drop(const State<N> S_end, const GPS &gps_target) {
 
 
 /**
- * @brief initialize and run the model
+ * @brief fill the per launch parameters and initial states of a batch
  *
- * @param size       : num of launches
- * @param wind       : {wind[2*i+0], wind[2*i+1]} is {rad, m/s} of the wind (remind: 0° = the wind go to Sud from North)
- * @param vel        : {vel[3*i+0], vel[3*i+1], vel[3*i+2]} is {heading, magnitude, v_down} of the UAV velocity
- * @param target     : {target[2*i+0], target[2*i+1]} is the GPS position of the target
- * @param h          : h[i] is the altitude (m)
- * @param m          : m[i] is the mass of the payload (kg)
- * @param CdS        : is the coefficient of the parachute (m2)
- * @param time       : time of the simulation (s)
- * @param step       : step of the simulation (s)
- * @param integrator : integrator of the simulation
- * @param result     : {result[2*i+0], result[2*i+1]} GPS coordinate of the launch
- * @return int       : 0 = anyError, 1 = anErrorEncountered
+ * Same inputs as cxx_dropPoints, the canopy opens at t = 1 s.
  */
-int cxx_dropPoints(int size, double* wind, double* vel, double* target, double* h,
-            double* m, double CdS, double time, double step,
-            const char* integrator, double* result) {
-    std::string integrator_i = integrator;
-    Simulation s(step, time, integrator_i);
-
+static void make_launches(int size, double* wind, double* vel, double* h,
+                          double* m, double CdS, LaunchBatch& batch,
+                          std::vector<State<3>>& v_S0) {
+    batch.reserve(size);
+    v_S0.reserve(size);
     for (int i = 0; i < size; i++) {
         double wind_head = wind[2 * i + 0];
         double wind_speed = wind[2 * i + 1];
@@ -56,56 +45,74 @@ int cxx_dropPoints(int size, double* wind, double* vel, double* target, double*
         double vel_speed = vel[3 * i + 1];
         double vel_down = vel[3 * i + 2];
 
-        double target_lat = target[2 * i + 0];
-        double target_lon = target[2 * i + 1];
-
-        double h_i = h[i];
+        batch.push_back(m[i], CdS,
+                        VReal3{wind_speed * cos(wind_head),
+                               wind_speed * sin(wind_head), 0},
+                        1);
+        v_S0.push_back(State<3>{0,
+                                0,
+                                -h[i],
+                                vel_speed * cos(vel_head),
+                                vel_speed * sin(vel_head),
+                                vel_down});
+    }
+}
 
-        double mass_i = m[i];
+// Cache of the integrated drops, off until setDropCache is called
+static std::unique_ptr<DropCache> drop_cache;
 
-        GPS gps_target = {target_lat, target_lon};
+// Real-time predictor, off until startPredictor is called
+static std::unique_ptr<Predictor> predictor;
 
-        // Wind law
-        std::function<VReal3(const State<3>&, const VReal<3>&, double)>
-            wind_law = [wind_head, wind_speed](const State<3>& state,
-                                               const VReal<3>& pos, double t) {
-                return VReal<3>{wind_speed * cos(wind_head),
-                                wind_speed * sin(wind_head), 0};
-            };
-        // CdS
-        std::function<double(const State<3>&, double)> cds_payload =
-            [CdS](const State<3>& s, double t) {
-                if (t <= 1) {
-                    return 0.0;
-                } else {
-                    return CdS;
-                }
-            };
+// Wind estimated from air data, off until startWindEstimator is called
+static std::unique_ptr<WindEstimator> wind_estimator;
 
-        // Create the paychute and wind
-        PayChute<3> pc(cds_payload, mass_i);
-        Wind<3> Vw(wind_law);
+// Autotune profile, loaded by loadProfile
+static std::unique_ptr<ODESettings> profile;
 
-        // Create the ballistic model
-        BallisticModel bm(pc, Vw);
-        // Create simulation object
+/* Settings of the runs: 'profile' as integrator takes the method, step and
+   terminal tail of the loaded profile, see Autotune.h. Reads the profile,
+   so call it with the GIL held: the calls that release it resolve their
+   settings first and pass them on by value */
+static ODESettings sim_settings(double step, double time,
+                                const std::string& integrator) {
+    if (integrator == "profile") {
+        if (!profile) throw std::invalid_argument("no profile loaded");
+        return {profile->dt, time, profile->method, profile->tail_tol};
+    }
+    return {step, time, integrator, 0};
+}
 
+/**
+ * @brief closed form approximation of the drop points, see AnalyticDrop.h
+ *
+ * @param size       : num of launches
+ * @param wind       : {wind[2*i+0], wind[2*i+1]} is {rad, m/s} of the wind (remind: 0° = the wind go to Sud from North)
+ * @param vel        : {vel[3*i+0], vel[3*i+1], vel[3*i+2]} is {heading, magnitude, v_down} of the UAV velocity
+ * @param target     : {target[2*i+0], target[2*i+1]} is the GPS position of the target
+ * @param h          : h[i] is the altitude (m)
+ * @param m          : m[i] is the mass of the payload (kg)
+ * @param CdS        : is the coefficient of the parachute (m2)
+ * @param time       : time of the simulation (s)
+ * @param result     : {result[2*i+0], result[2*i+1]} GPS coordinate of the launch
+ * @return int       : 0 = anyError, 1 = anErrorEncountered
+ */
+int cxx_analyticDropPoints(int size, double* wind, double* vel, double* target,
+            double* h, double* m, double CdS, double time, double* result) {
+    for (int i = 0; i < size; i++) {
+        VReal3 wind_i{wind[2 * i + 1] * cos(wind[2 * i + 0]),
+                      wind[2 * i + 1] * sin(wind[2 * i + 0]), 0};
         State<3> S0 = {0,
                        0,
-                       -h_i,
-                       vel_speed * cos(vel_head),
-                       vel_speed * sin(vel_head),
-                       vel_down};
-
-        // Run the simulation
-        Results<3> res = s.run(bm, S0);
+                       -h[i],
+                       vel[3 * i + 1] * cos(vel[3 * i + 0]),
+                       vel[3 * i + 1] * sin(vel[3 * i + 0]),
+                       vel[3 * i + 2]};
 
-        // Get the last state
-        State<3> S_end = res.getLast();
-
-        // Get the drop point
-        GPS gps_drop = get_drop<3>(S_end, gps_target);
+        State<3> S_end = analytic_drop(S0, wind_i, CdS, m[i], 1, time);
 
+        GPS gps_drop =
+            get_drop<3>(S_end, {target[2 * i + 0], target[2 * i + 1]});
         result[2 * i + 0] = gps_drop.lat;
         result[2 * i + 1] = gps_drop.lon;
     }
@@ -125,77 +132,135 @@ int cxx_dropPoints(int size, double* wind, double* vel, double* target, double*
  * @param CdS        : is the coefficient of the parachute (m2)
  * @param time       : time of the simulation (s)
  * @param step       : step of the simulation (s)
- * @param integrator : integrator of the simulation
- * @param result     : result[i][j + 7*k] is the j-th coordinate of the i-th launch
- *                     {N,E,D,Vn,Ve,Vd,t} (m, m/s, s) is the NED coordinate of the payload
- * @param lengths    : lengths[i] is the length of the i-th launch
+ * @param integrator : integrator of the simulation, 'analytic' for the closed
+ *                     form approximation
+ * @param result     : {result[2*i+0], result[2*i+1]} GPS coordinate of the launch
+ * @param tail_tol   : acceleration tolerance of the terminal tail (m/s2), 0 = off
+ * @param tail_err   : tail_err[i] is the error bound of the terminal tail (m),
+ *                     can be NULL
  * @return int       : 0 = anyError, 1 = anErrorEncountered
+ *
+ * With the drop cache enabled only the launches missing from it are run.
  */
-int cxx_trajectories(int size, double* wind, double* vel, double* target, double* h,
+int cxx_dropPoints(int size, double* wind, double* vel, double* target, double* h,
             double* m, double CdS, double time, double step,
-            const char* integrator, double** result, int* lengths) {
+            const char* integrator, double* result, double tail_tol = 0,
+            double* tail_err = NULL) {
     std::string integrator_i = integrator;
-    Simulation s(step, time, integrator_i);
-
-    for (int i = 0; i < size; i++) {
-        double wind_head = wind[2 * i + 0];
-        double wind_speed = wind[2 * i + 1];
-
-        double vel_head = vel[3 * i + 0];
-        double vel_speed = vel[3 * i + 1];
-        double vel_down = vel[3 * i + 2];
-
-        double target_lat = target[2 * i + 0];
-        double target_lon = target[2 * i + 1];
+    if (integrator_i == "analytic") {
+        if (tail_err)
+            for (int i = 0; i < size; i++) tail_err[i] = 0;
+        return cxx_analyticDropPoints(size, wind, vel, target, h, m, CdS, time,
+                                      result);
+    }
+    ODESettings cfg = sim_settings(step, time, integrator_i);
+    if (tail_tol > 0) cfg.tail_tol = tail_tol;
+    Simulation s(cfg);
+
+    // Landings found in the cache, the other launches are run
+    std::vector<CachedDrop> landing(size);
+    std::vector<DropCache::Key> keys;
+    std::vector<int> miss;
+    if (drop_cache) {
+        keys.reserve(size);
+        for (int i = 0; i < size; i++) {
+            DropQuery q{h[i], vel[3 * i + 1], vel[3 * i + 0], vel[3 * i + 2],
+                        wind[2 * i + 1], wind[2 * i + 0], m[i], CdS,
+                        cfg.dt, time, cfg.tail_tol, cfg.method};
+            keys.push_back(drop_cache->key(q));
+            if (!drop_cache->find(keys[i], landing[i])) miss.push_back(i);
+        }
+    } else {
+        for (int i = 0; i < size; i++) miss.push_back(i);
+    }
 
-        double h_i = h[i];
+    if (!miss.empty()) {
+        std::vector<double> m_wind, m_vel, m_h, m_m;
+        for (int i : miss) {
+            m_wind.insert(m_wind.end(), wind + 2 * i, wind + 2 * i + 2);
+            m_vel.insert(m_vel.end(), vel + 3 * i, vel + 3 * i + 3);
+            m_h.push_back(h[i]);
+            m_m.push_back(m[i]);
+        }
+        LaunchBatch batch;
+        std::vector<State<3>> v_S0;
+        make_launches((int)miss.size(), m_wind.data(), m_vel.data(),
+                      m_h.data(), m_m.data(), CdS, batch, v_S0);
+
+        // Live query: endpoint-only runs ahead of the background sweeps
+        s.set_priority(Priority::LIVE);
+        std::vector<double> errs;
+        std::vector<State<3>> last =
+            s.run_parallel_sweep(LaunchSweep{batch, v_S0}, 16, &errs);
+        for (size_t k = 0; k < miss.size(); k++) {
+            CachedDrop& d = landing[miss[k]];
+            d.north = last[k].X()[0];
+            d.east = last[k].X()[1];
+            d.tail_err = errs[k];
+            if (drop_cache) drop_cache->insert(keys[miss[k]], d);
+        }
+    }
 
-        double mass_i = m[i];
+    for (int i = 0; i < size; i++) {
+        GPS gps_target = {target[2 * i + 0], target[2 * i + 1]};
 
-        GPS gps_target = {target_lat, target_lon};
+        // Get the drop point from the landing offset
+        State<3> S_end{landing[i].north, landing[i].east, 0, 0, 0, 0};
+        GPS gps_drop = get_drop<3>(S_end, gps_target);
 
-        // Wind law
-        std::function<VReal3(const State<3>&, const VReal<3>&, double)>
-            wind_law = [wind_head, wind_speed](const State<3>& state,
-                                               const VReal<3>& pos, double t) {
-                return VReal<3>{wind_speed * cos(wind_head),
-                                wind_speed * sin(wind_head), 0};
-            };
-        // CdS
-        std::function<double(const State<3>&, double)> cds_payload =
-            [CdS](const State<3>& s, double t) {
-                if (t <= 1) {
-                    return 0.0;
-                } else {
-                    return CdS;
-                }
-            };
+        result[2 * i + 0] = gps_drop.lat;
+        result[2 * i + 1] = gps_drop.lon;
+        if (tail_err) tail_err[i] = landing[i].tail_err;
+    }
 
-        // Create the paychute and wind
-        PayChute<3> pc(cds_payload, mass_i);
-        Wind<3> Vw(wind_law);
+    return 0;
+}
 
-        // Create the ballistic model
-        BallisticModel bm(pc, Vw);
-        // Create simulation object
+/**
+ * @brief initialize and run the model
+ *
+ * @param size       : num of launches
+ * @param wind       : {wind[2*i+0], wind[2*i+1]} is {rad, m/s} of the wind (remind: 0° = the wind go to Sud from North)
+ * @param vel        : {vel[3*i+0], vel[3*i+1], vel[3*i+2]} is {heading, magnitude, v_down} of the UAV velocity
+ * @param target     : {target[2*i+0], target[2*i+1]} is the GPS position of the target, unused (NED result)
+ * @param h          : h[i] is the altitude (m)
+ * @param m          : m[i] is the mass of the payload (kg)
+ * @param CdS        : is the coefficient of the parachute (m2)
+ * @param time       : time of the simulation (s)
+ * @param step       : step of the simulation (s)
+ * @param integrator : integrator of the simulation
+ * @param result     : result[i][j + 7*k] is the j-th coordinate of the i-th launch
+ *                     {N,E,D,Vn,Ve,Vd,t} (m, m/s, s) is the NED coordinate of the payload
+ * @param lengths    : lengths[i] is the length of the i-th launch
+ * @param tail_tol   : acceleration tolerance of the terminal tail (m/s2), 0 = off
+ * @return int       : 0 = anyError, 1 = anErrorEncountered
+ */
+int cxx_trajectories(int size, double* wind, double* vel,
+            [[maybe_unused]] double* target, double* h,
+            double* m, double CdS, double time, double step,
+            const char* integrator, double** result, int* lengths,
+            double tail_tol = 0) {
+    std::string integrator_i = integrator;
+    ODESettings cfg = sim_settings(step, time, integrator_i);
+    if (tail_tol > 0) cfg.tail_tol = tail_tol;
+    Simulation s(cfg);
 
-        State<3> S0 = {0,
-                       0,
-                       -h_i,
-                       vel_speed * cos(vel_head),
-                       vel_speed * sin(vel_head),
-                       vel_down};
+    LaunchBatch batch;
+    std::vector<State<3>> v_S0;
+    make_launches(size, wind, vel, h, m, CdS, batch, v_S0);
 
-        // Run the simulation
-        Results<3> res = s.run(bm, S0);
+    // Run the simulations
+    Results<3> res = s.run_parallel_batch(batch, std::span<State<3>>(v_S0));
 
+    SFT_TRACE_SPAN("bridge", "copy");
+    for (int i = 0; i < size; i++) {
         // Alloc memory
-        lengths[i] = res[0].size();
+        lengths[i] = res[i].size();
         result[i] = (double*)malloc(lengths[i] * 7 * sizeof(double));
         if (!result[i]) return 1;
 
         for (int k = 0; k < lengths[i]; ++k) {
-            State<3> S = res[0][k];
+            State<3> S = res[i][k];
             result[i][7 * k + 0] = S.X()[0];
             result[i][7 * k + 1] = S.X()[1];
             result[i][7 * k + 2] = S.X()[2];
@@ -209,6 +274,349 @@ int cxx_trajectories(int size, double* wind, double* vel, double* target, double
     return 0;
 }
 
+/**
+ * @brief run the model and interpolate the trajectories at given times or
+ *        altitudes, see Interpolation.h
+ *
+ * @param size        : num of launches
+ * @param wind        : {wind[2*i+0], wind[2*i+1]} is {rad, m/s} of the wind (remind: 0° = the wind go to Sud from North)
+ * @param vel         : {vel[3*i+0], vel[3*i+1], vel[3*i+2]} is {heading, magnitude, v_down} of the UAV velocity
+ * @param h           : h[i] is the altitude (m)
+ * @param m           : m[i] is the mass of the payload (kg)
+ * @param CdS         : is the coefficient of the parachute (m2)
+ * @param time        : time of the simulation (s)
+ * @param step        : step of the simulation (s)
+ * @param integrator  : integrator of the simulation
+ * @param by_altitude : 0 = queries are times (s), 1 = queries are altitudes (m)
+ * @param n_queries   : num of queries, applied to every launch
+ * @param queries     : queries[k] is the k-th time or altitude
+ * @param result      : result[7*(i*n_queries+k) + j] is the j-th coordinate
+ *                      {N,E,D,Vn,Ve,Vd,t} of the i-th launch at the k-th query
+ * @param found       : found[i*n_queries+k] is 0 if the i-th launch never
+ *                      crosses the k-th altitude
+ * @return int        : 0 = anyError, 1 = anErrorEncountered
+ */
+int cxx_trajectoryAt(int size, double* wind, double* vel, double* h, double* m,
+                     double CdS, double time, double step,
+                     const char* integrator, int by_altitude, int n_queries,
+                     double* queries, double* result, int* found) {
+    std::string integrator_i = integrator;
+    Simulation s(sim_settings(step, time, integrator_i));
+    s.set_dense_output(true);
+
+    LaunchBatch batch;
+    std::vector<State<3>> v_S0;
+    make_launches(size, wind, vel, h, m, CdS, batch, v_S0);
+
+    // Run the simulations
+    Results<3> res = s.run_parallel_batch(batch, std::span<State<3>>(v_S0));
+
+    for (int i = 0; i < size; i++) {
+        DenseTrajectory<3> traj = res.dense(i);
+        for (int k = 0; k < n_queries; ++k) {
+            int q = i * n_queries + k;
+            State<3> S;
+            if (by_altitude) {
+                found[q] = traj.at_altitude(queries[k], S);
+            } else {
+                S = traj.at_time(queries[k]);
+                found[q] = 1;
+            }
+            for (int j = 0; j < 6; ++j) result[7 * q + j] = S[j];
+            result[7 * q + 6] = S.get_t();
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief find the release window of a flight line, see DropWindow.h
+ *
+ * @param line       : the flight line, heading in rad
+ * @param target     : GPS position of the target
+ * @param radius     : acceptance radius around the target (m)
+ * @param wind       : {wind[0], wind[1]} is {rad, m/s} of the wind
+ * @param m          : mass of the payload (kg)
+ * @param CdS        : is the coefficient of the parachute (m2)
+ * @param time       : time of the simulation (s)
+ * @param step       : step of the simulation (s)
+ * @param integrator : integrator of the simulation
+ * @param way_d      : distance of the first and last waypoint from the
+ *                     window center (m), 0 = window endpoints
+ * @param result     : the window
+ * @return int       : 0 = anyError, 1 = anErrorEncountered
+ */
+int cxx_dropWindow(const FlightLine& line, GPS target, double radius,
+                   double* wind, double m, double CdS, double time,
+                   double step, const char* integrator, double way_d,
+                   DropWindow* result) {
+    std::string integrator_i = integrator;
+    Simulation s(sim_settings(step, time, integrator_i));
+    FixedBallisticModel bm(
+        m, CdS, VReal3{wind[1] * cos(wind[0]), wind[1] * sin(wind[0]), 0}, 1);
+    *result = find_drop_window(s, line, target, radius, bm, 64, 0.1, way_d);
+    return 0;
+}
+
+/**
+ * @brief rank the run-in headings by landing spread, see HeadingPlanner.h
+ *
+ * @param target     : GPS position of the target
+ * @param cond       : nominal drop conditions
+ * @param unc        : 1-sigma uncertainty of the inputs
+ * @param n_headings : num of candidate headings over 360 degrees
+ * @param time       : time of the simulation (s)
+ * @param step       : step of the simulation (s)
+ * @param integrator : integrator of the simulation
+ * @param way_d      : distance of the first and last waypoint (m)
+ * @param result     : the candidates, lowest spread first
+ * @return int       : 0 = anyError, 1 = anErrorEncountered
+ */
+int cxx_rankHeadings(GPS target, const ApproachConditions& cond,
+                     const DropUncertainty& unc, int n_headings, double time,
+                     double step, const char* integrator, double way_d,
+                     std::vector<HeadingCandidate>* result) {
+    std::string integrator_i = integrator;
+    Simulation s(sim_settings(step, time, integrator_i));
+    *result = rank_headings(s, target, cond, unc, n_headings, way_d);
+    return 0;
+}
+
+/**
+ * @brief landing dispersion of uncertain drop inputs, see Unscented.h
+ *
+ * @param dist       : mean and covariance of the inputs
+ * @param time       : time of the simulation (s)
+ * @param step       : step of the simulation (s)
+ * @param integrator : integrator of the simulation
+ * @param ut         : unscented transform estimate, can be NULL
+ * @param mc         : Monte Carlo estimate, can be NULL
+ * @param n_mc       : num of Monte Carlo drops
+ * @param seed       : seed of the Monte Carlo samples
+ * @return int       : 0 = anyError, 1 = anErrorEncountered
+ */
+int cxx_dispersion(const DropDistribution& dist, double time, double step,
+                   const char* integrator, LandingSpread* ut,
+                   LandingSpread* mc, int n_mc = 10000, unsigned seed = 0) {
+    std::string integrator_i = integrator;
+    Simulation s(sim_settings(step, time, integrator_i));
+    if (ut) *ut = unscented_landing(s, dist);
+    if (mc) *mc = monte_carlo_landing(s, dist, n_mc, seed);
+    return 0;
+}
+
+/**
+ * @brief landing predicted within a time budget, see Anytime.h
+ *
+ * @param q          : the drop, its inputs and the fine and coarse steps
+ * @param budget     : time budget (s)
+ * @param on_level   : called with each level completed
+ * @param result     : best level completed within the budget
+ * @return int       : 0 = anyError, 1 = anErrorEncountered
+ */
+int cxx_anytimeDrop(const AnytimeQuery& q, double budget,
+                    const std::function<void(const AnytimeResult&)>& on_level,
+                    AnytimeResult* result) {
+    auto deadline = std::chrono::steady_clock::now() +
+                    std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                        std::chrono::duration<double>(budget));
+    *result = anytime_landing(q, deadline, on_level);
+    return 0;
+}
+
+/**
+ * @brief mean landing of uncertain drop inputs with QMC and variance
+ *        reduction, see QMC.h
+ *
+ * @param dist       : mean and covariance of the inputs
+ * @param n_runs     : num of simulations
+ * @param cfg        : integrator, step (s), time (s) and terminal tail of the
+ *                     simulation, see sim_settings
+ * @param opt        : sampling and variance reduction
+ * @param result     : the estimate and its standard error
+ * @return int       : 0 = anyError, 1 = anErrorEncountered
+ */
+int cxx_qmcMean(const DropDistribution& dist, int n_runs,
+                const ODESettings& cfg, const SamplingOptions& opt,
+                MeanEstimate* result) {
+    Simulation s(cfg);
+    s.set_priority(Priority::BULK);
+    *result = landing_mean(s, dist, n_runs, opt);
+    return 0;
+}
+
+/**
+ * @brief convergence curves of the mean landing, see landing_convergence
+ *
+ * @param dist       : mean and covariance of the inputs
+ * @param n_min      : num of simulations of the first point
+ * @param n_max      : num of simulations of the last point
+ * @param cfg        : integrator, step (s), time (s) and terminal tail of the
+ *                     simulation, see sim_settings
+ * @param seed       : seed of the samples
+ * @param result     : the points of the curves
+ * @return int       : 0 = anyError, 1 = anErrorEncountered
+ */
+int cxx_qmcConvergence(const DropDistribution& dist, int n_min, int n_max,
+                       const ODESettings& cfg, unsigned seed,
+                       std::vector<ConvergencePoint>* result) {
+    Simulation s(cfg);
+    s.set_priority(Priority::BULK);
+    *result = landing_convergence(s, dist, n_min, n_max, seed);
+    return 0;
+}
+
+/**
+ * @brief Sobol indices of the landing of each launch, see Sensitivity.h
+ *
+ * @param size       : num of launches
+ * @param wind       : {wind[2*i+0], wind[2*i+1]} is {rad, m/s} of the wind (remind: 0° = the wind go to Sud from North)
+ * @param vel        : {vel[3*i+0], vel[3*i+1], vel[3*i+2]} is {heading, magnitude, v_down} of the UAV velocity
+ * @param h          : h[i] is the altitude (m)
+ * @param m          : m[i] is the mass of the payload (kg)
+ * @param CdS        : is the coefficient of the parachute (m2)
+ * @param sd         : 1-sigma of {wind N, wind E, CdS, mass, vel N, vel E,
+ *                     vel D}, the inputs are independent
+ * @param n          : base sample size, (7 + 2) * n runs per launch
+ * @param cfg        : integrator, step (s), time (s) and terminal tail of the
+ *                     simulation, see sim_settings
+ * @param seed       : seed of the Sobol points
+ * @param result     : result[i] are the indices of the i-th launch
+ * @return int       : 0 = anyError, 1 = anErrorEncountered
+ */
+int cxx_sobolIndices(int size, double* wind, double* vel, double* h, double* m,
+                     double CdS, const double* sd, int n,
+                     const ODESettings& cfg, unsigned seed,
+                     SobolIndices* result) {
+    using D = DropDistribution;
+    Simulation s(cfg);
+    s.set_priority(Priority::BULK);
+    for (int i = 0; i < size; i++) {
+        D dist;
+        dist.h = h[i];
+        dist.mean[D::WIND_N] = wind[2 * i + 1] * cos(wind[2 * i + 0]);
+        dist.mean[D::WIND_E] = wind[2 * i + 1] * sin(wind[2 * i + 0]);
+        dist.mean[D::CDS] = CdS;
+        dist.mean[D::MASS] = m[i];
+        dist.mean[D::VEL_N] = vel[3 * i + 1] * cos(vel[3 * i + 0]);
+        dist.mean[D::VEL_E] = vel[3 * i + 1] * sin(vel[3 * i + 0]);
+        dist.mean[D::VEL_D] = vel[3 * i + 2];
+        for (int k = 0; k < D::N_INPUTS; k++) {
+            dist.cov[k][k] = sd[k] * sd[k];
+        }
+        result[i] = sobol_indices(s, dist, n, seed);
+    }
+    return 0;
+}
+
+/**
+ * @brief effective wind of logged drops, see WindInversion.h
+ *
+ * @param size       : num of launches
+ * @param wind       : {wind[2*i+0], wind[2*i+1]} is {rad, m/s} of the reported wind, first guess
+ * @param vel        : {vel[3*i+0], vel[3*i+1], vel[3*i+2]} is {heading, magnitude, v_down} of the UAV velocity
+ * @param land       : {land[2*i+0], land[2*i+1]} is the GPS position of the landing
+ * @param drop       : {drop[2*i+0], drop[2*i+1]} is the GPS position of the release
+ * @param h          : h[i] is the altitude (m)
+ * @param m          : m[i] is the mass of the payload (kg)
+ * @param opt        : calibrated CdS and solver settings
+ * @param cfg        : integrator, step (s), time (s) and terminal tail of the
+ *                     simulation, see sim_settings
+ * @param result     : result[i] is the wind of the i-th launch
+ * @param errors     : fitted minus reported wind over the converged launches
+ * @return int       : 0 = anyError, 1 = anErrorEncountered
+ */
+int cxx_windInversion(int size, double* wind, double* vel, double* land,
+                      double* drop, double* h, double* m,
+                      const WindInversionOptions& opt, const ODESettings& cfg,
+                      std::vector<WindFit>* result, LandingSpread* errors) {
+    Simulation s(cfg);
+    s.set_priority(Priority::BULK);
+    std::vector<RecordedDrop> drops(size);
+    for (int i = 0; i < size; i++) {
+        RecordedDrop& d = drops[i];
+        d.h = h[i];
+        d.mass = m[i];
+        d.vel_n = vel[3 * i + 1] * cos(vel[3 * i + 0]);
+        d.vel_e = vel[3 * i + 1] * sin(vel[3 * i + 0]);
+        d.vel_d = vel[3 * i + 2];
+        d.wind_n = wind[2 * i + 1] * cos(wind[2 * i + 0]);
+        d.wind_e = wind[2 * i + 1] * sin(wind[2 * i + 0]);
+        GeoFrame(GPS{drop[2 * i], drop[2 * i + 1]})
+            .to_enu(&land[2 * i], &land[2 * i + 1], 1, &d.land_n, &d.land_e);
+    }
+    *result = invert_winds(s, drops, opt);
+    *errors = wind_errors(drops, *result);
+    return 0;
+}
+
+/**
+ * @brief cheapest integrator and step within a landing error, see Autotune.h
+ *
+ * @param size       : num of launches, the representative drops
+ * @param wind       : {wind[2*i+0], wind[2*i+1]} is {rad, m/s} of the wind
+ * @param vel        : {vel[3*i+0], vel[3*i+1], vel[3*i+2]} is {heading, magnitude, v_down} of the UAV velocity
+ * @param h          : h[i] is the altitude (m)
+ * @param m          : m[i] is the mass of the payload (kg)
+ * @param CdS        : is the coefficient of the parachute (m2)
+ * @param opt        : tolerance and search space
+ * @param result     : the chosen setting and all those tried
+ * @return int       : 0 = anyError, 1 = anErrorEncountered
+ */
+int cxx_autotune(int size, double* wind, double* vel, double* h, double* m,
+                 double CdS, const AutotuneOptions& opt,
+                 AutotuneResult* result) {
+    LaunchBatch batch;
+    std::vector<State<3>> v_S0;
+    make_launches(size, wind, vel, h, m, CdS, batch, v_S0);
+    *result = autotune(LaunchSweep{batch, v_S0}, opt);
+    return 0;
+}
+
+/**
+ * @brief run the model over a cartesian sweep of drop conditions
+ *
+ * @param sweep      : the axes of the sweep, see Sweep.h
+ * @param cfg        : integrator, step (s), time (s) and terminal tail of the
+ *                     simulation, see sim_settings; 'analytic' as integrator
+ *                     for the closed form approximation
+ * @param result     : {result[3*i+0], result[3*i+1], result[3*i+2]} is the
+ *                     {N, E, t} (m, m, s) of the landing of the i-th
+ *                     combination, relative to the release point
+ * @return int       : 0 = anyError, 1 = anErrorEncountered
+ */
+int cxx_dropSweep(const DropSweep& sweep, const ODESettings& cfg,
+                  double* result) {
+    if (cfg.method == "analytic") {
+        for (size_t i = 0; i < sweep.size(); i++) {
+            auto val = sweep.values(i);
+            auto [bm, S0] = sweep.at(i);
+            VReal3 wind{val[DropSweep::WIND_SPEED] *
+                            cos(val[DropSweep::WIND_HEAD]),
+                        val[DropSweep::WIND_SPEED] *
+                            sin(val[DropSweep::WIND_HEAD]),
+                        0};
+            State<3> S_end = analytic_drop(S0, wind, sweep.cds,
+                                           val[DropSweep::MASS], sweep.t_open,
+                                           cfg.T);
+            result[3 * i + 0] = S_end.X()[0];
+            result[3 * i + 1] = S_end.X()[1];
+            result[3 * i + 2] = S_end.get_t();
+        }
+        return 0;
+    }
+    Simulation s(cfg);
+    s.set_priority(Priority::BULK);
+    std::vector<State<3>> last = s.run_parallel_sweep(sweep);
+    for (size_t i = 0; i < last.size(); i++) {
+        result[3 * i + 0] = last[i].X()[0];
+        result[3 * i + 1] = last[i].X()[1];
+        result[3 * i + 2] = last[i].get_t();
+    }
+    return 0;
+}
+
 #include <Python.h>
 
 #if defined(__cplusplus)
@@ -216,69 +624,68 @@ extern "C" {
 #endif /*defined(__cplusplus)*/
 
 #include <stdio.h>
+#include <string.h>
 
 #define KT2M 0.541 /* 1 knot = 0.541 m/s */
 
-static PyObject* dropPoints(PyObject* self, PyObject* args) {
-    /* params of run */
-    PyObject *wind, /* describe the wind:   '{degree}{nodes}KT'          */
-        *vel,       /* velocity of UAV:   [radians, magnitude, v_down]   */
-        *target,    /* GPS target position: [latitude, longitude]        */
-        *h,         /* altitude of UAV (in m)                            */
-        *m;         /* Mass of payloads (in g)                           */
-    float CdS;      /* CdS coefficient of parachutes  */
-    int time,       /* Time of the simulation (in s)  */
-        step;       /* Step of the simulation (in ms) */
-    const char* integrator; /* integrator */
-
-    if (!PyArg_ParseTuple(args, "OOOOOfiis", &wind, &vel, &target, &h, &m, &CdS,
-                          &time, &step, &integrator)) {
-        return NULL;
-    }
+/* releases the GIL while alive, so other python threads (e.g. live
+ * dropPoints) run during the long background calls; C++ code only inside */
+struct ReleaseGIL {
+    PyThreadState* state = PyEval_SaveThread();
+    ~ReleaseGIL() { PyEval_RestoreThread(state); }
+};
+
+/* launches given as python lists, converted to C arrays */
+typedef struct {
+    Py_ssize_t size;
+    double *wind,   /* {rad, m/s} of the wind                 */
+        *vel,       /* {heading, magnitude, v_down} of UAV    */
+        *target,    /* {latitude, longitude} of the target    */
+        *h,         /* altitude (m)                           */
+        *m;         /* mass of the payload                    */
+} Launches;
+
+static void free_launches(Launches* l) {
+    free(l->m);
+    free(l->h);
+    free(l->target);
+    free(l->vel);
+    free(l->wind);
+}
 
+/* parse the lists of launches, 0 = ok, -1 = error (python exception set) */
+static int parse_launches(PyObject* wind, PyObject* vel, PyObject* target,
+                          PyObject* h, PyObject* m, Launches* l) {
     /* check the objects */
-    {
-        int flag_wind = !PyList_Check(wind), flag_vel = !PyList_Check(vel),
-            flag_target = !PyList_Check(target), flag_h = !PyList_Check(h),
-            flag_m = !PyList_Check(m);
-        if (flag_wind || flag_vel || flag_target || flag_h || flag_m) {
-            return NULL;
-        }
+    if (!PyList_Check(wind) || !PyList_Check(vel) || !PyList_Check(target) ||
+        !PyList_Check(h) || !PyList_Check(m)) {
+        PyErr_SetString(PyExc_TypeError, "launches must be lists");
+        return -1;
     }
 
     /* check size */
-    Py_ssize_t size = 0;
-    if (size == 0)
-        size = PyList_GET_SIZE(wind);
-    else if (size != PyList_GET_SIZE(wind))
-        return NULL;
-    if (size == 0)
-        size = PyList_GET_SIZE(vel);
-    else if (size != PyList_GET_SIZE(vel))
-        return NULL;
-    if (size == 0)
-        size = PyList_GET_SIZE(target);
-    else if (size != PyList_GET_SIZE(target))
-        return NULL;
-    if (size == 0)
-        size = PyList_GET_SIZE(h);
-    else if (size != PyList_GET_SIZE(h))
-        return NULL;
-    if (size == 0)
-        size = PyList_GET_SIZE(m);
-    else if (size != PyList_GET_SIZE(m))
-        return NULL;
-    if (size == 0) return NULL;
+    Py_ssize_t size = PyList_GET_SIZE(wind);
+    if (size == 0 || size != PyList_GET_SIZE(vel) ||
+        size != PyList_GET_SIZE(target) || size != PyList_GET_SIZE(h) ||
+        size != PyList_GET_SIZE(m)) {
+        PyErr_SetString(PyExc_ValueError,
+                        "launch lists must have the same nonzero size");
+        return -1;
+    }
 
     /* alloc memory */
-    double *c_wind = (double*)malloc(size * 2 * sizeof(double)),
-           *c_vel = (double*)malloc(size * 3 * sizeof(double)),
-           *c_target = (double*)malloc(size * 2 * sizeof(double)),
-           *c_h = (double*)malloc(size * sizeof(double)),
-           *c_m = (double*)malloc(size * sizeof(double));
-    if (c_wind == NULL || c_vel == NULL || c_target == NULL || c_h == NULL ||
-        c_m == NULL)
-        return NULL;
+    l->size = size;
+    l->wind = (double*)malloc(size * 2 * sizeof(double));
+    l->vel = (double*)malloc(size * 3 * sizeof(double));
+    l->target = (double*)malloc(size * 2 * sizeof(double));
+    l->h = (double*)malloc(size * sizeof(double));
+    l->m = (double*)malloc(size * sizeof(double));
+    if (l->wind == NULL || l->vel == NULL || l->target == NULL ||
+        l->h == NULL || l->m == NULL) {
+        free_launches(l);
+        PyErr_NoMemory();
+        return -1;
+    }
 
     /* initialize memory */
     for (Py_ssize_t i = 0; i < size; ++i) {
@@ -286,58 +693,118 @@ static PyObject* dropPoints(PyObject* self, PyObject* args) {
                  *item_vel = PyList_GET_ITEM(vel, i),
                  *item_target = PyList_GET_ITEM(target, i);
         {
-            int angle_grad;
-            int speed_knots;
+            int angle_grad = 0;
+            int speed_knots = 0;
             const char* str = PyUnicode_AsUTF8(item_wind);
+            if (str == NULL) {
+                free_launches(l);
+                return -1;
+            }
             sscanf(str, "%3d%2dKT", &angle_grad, &speed_knots);
-            c_wind[2 * i] = angle_grad * M_PI / 180.0;
-            c_wind[2 * i + 1] = speed_knots * KT2M;
+            l->wind[2 * i] = angle_grad * M_PI / 180.0;
+            l->wind[2 * i + 1] = speed_knots * KT2M;
         }
-        if (!PyTuple_Check(item_vel) || PyTuple_GET_SIZE(item_vel) != 3)
-            return NULL;
-        c_vel[3 * i + 0] = PyFloat_AsDouble(PyTuple_GET_ITEM(item_vel, 0));
-        c_vel[3 * i + 1] = PyFloat_AsDouble(PyTuple_GET_ITEM(item_vel, 1));
-        c_vel[3 * i + 2] = PyFloat_AsDouble(PyTuple_GET_ITEM(item_vel, 2));
+        if (!PyTuple_Check(item_vel) || PyTuple_GET_SIZE(item_vel) != 3 ||
+            !PyTuple_Check(item_target) ||
+            PyTuple_GET_SIZE(item_target) != 2) {
+            free_launches(l);
+            PyErr_SetString(PyExc_TypeError,
+                            "vel must be 3-tuples and target 2-tuples");
+            return -1;
+        }
+        l->vel[3 * i + 0] = PyFloat_AsDouble(PyTuple_GET_ITEM(item_vel, 0));
+        l->vel[3 * i + 1] = PyFloat_AsDouble(PyTuple_GET_ITEM(item_vel, 1));
+        l->vel[3 * i + 2] = PyFloat_AsDouble(PyTuple_GET_ITEM(item_vel, 2));
 
-        if (!PyTuple_Check(item_target) || PyTuple_GET_SIZE(item_target) != 2)
-            return NULL;
-        c_target[2 * i + 0] =
+        l->target[2 * i + 0] =
             PyFloat_AsDouble(PyTuple_GET_ITEM(item_target, 0));
-        c_target[2 * i + 1] =
+        l->target[2 * i + 1] =
             PyFloat_AsDouble(PyTuple_GET_ITEM(item_target, 1));
 
-        c_h[i] = PyFloat_AsDouble(PyList_GET_ITEM(h, i));
-        c_m[i] = PyFloat_AsDouble(PyList_GET_ITEM(m, i));
+        l->h[i] = PyFloat_AsDouble(PyList_GET_ITEM(h, i));
+        l->m[i] = PyFloat_AsDouble(PyList_GET_ITEM(m, i));
+    }
+    if (PyErr_Occurred()) {
+        free_launches(l);
+        return -1;
     }
+    return 0;
+}
 
-    /* prepare output */
-    double* result = (double*)malloc(size * 2 * sizeof(double));
-    if (result == NULL) return NULL;
-    int ret = cxx_dropPoints((int)size, c_wind, c_vel, c_target, c_h, c_m, CdS, time,
-                      step / 1000., integrator, result);
-    if (ret != 0) return NULL;
+/* contiguous 1-D buffer of doubles, e.g. array('d', ...) or a float64 array */
+static int get_doubles(PyObject* obj, Py_buffer* view) {
+    if (PyObject_GetBuffer(obj, view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) != 0)
+        return -1;
+    const char* fmt = view->format ? view->format : "B";
+    size_t len = strlen(fmt);
+    if (view->itemsize != sizeof(double) || len == 0 || fmt[len - 1] != 'd' ||
+        (len == 2 && fmt[0] != '<' && fmt[0] != '=' && fmt[0] != '@')) {
+        PyBuffer_Release(view);
+        PyErr_SetString(PyExc_TypeError, "buffer of doubles expected");
+        return -1;
+    }
+    return 0;
+}
 
-    /* convert result in List */
-    PyObject* resultObj = PyList_New(size);
-    for (Py_ssize_t i = 0; i < size; ++i) {
-        PyObject* item_result = PyTuple_New(2);
-        if (!item_result) return NULL;
-        PyTuple_SET_ITEM(item_result, 0, PyFloat_FromDouble(result[2 * i + 0]));
-        PyTuple_SET_ITEM(item_result, 1, PyFloat_FromDouble(result[2 * i + 1]));
-        PyList_SET_ITEM(resultObj, i, item_result);
+/* n input buffers of doubles of the same length, released by release_doubles */
+static Py_ssize_t get_doubles_n(PyObject** objs, Py_buffer* views, int n) {
+    for (int i = 0; i < n; ++i) {
+        if (get_doubles(objs[i], &views[i]) != 0) {
+            while (i-- > 0) PyBuffer_Release(&views[i]);
+            return -1;
+        }
     }
+    Py_ssize_t len = views[0].len;
+    for (int i = 1; i < n; ++i) {
+        if (views[i].len != len) {
+            for (int k = 0; k < n; ++k) PyBuffer_Release(&views[k]);
+            PyErr_SetString(PyExc_ValueError,
+                            "arrays must have the same length");
+            return -1;
+        }
+    }
+    return len / (Py_ssize_t)sizeof(double);
+}
 
-    free(result);
-    free(c_m);
-    free(c_h);
-    free(c_target);
-    free(c_vel);
-    free(c_wind);
-    return Py_BuildValue("O", resultObj);
+static void release_doubles(Py_buffer* views, int n) {
+    for (int i = 0; i < n; ++i) PyBuffer_Release(&views[i]);
 }
 
-static PyObject* trajectories(PyObject* self, PyObject* args) {
-   /* params of run */
+/* memoryview of doubles over buffer with the given shape, steals buffer */
+static PyObject* doubles_view(PyObject* buffer, PyObject* shape) {
+    if (buffer == NULL || shape == NULL) {
+        Py_XDECREF(buffer);
+        Py_XDECREF(shape);
+        return NULL;
+    }
+    PyObject* view = PyMemoryView_FromObject(buffer);
+    Py_DECREF(buffer);
+    if (view == NULL) {
+        Py_DECREF(shape);
+        return NULL;
+    }
+    PyObject* resultObj = PyObject_CallMethod(view, "cast", "sO", "d", shape);
+    Py_DECREF(view);
+    Py_DECREF(shape);
+    return resultObj;
+}
+
+/* two arrays of n doubles returned as a tuple of memoryviews */
+static PyObject* doubles_pair(PyObject* a, PyObject* b, Py_ssize_t n) {
+    PyObject* va = doubles_view(a, Py_BuildValue("(n)", n));
+    PyObject* vb = doubles_view(b, Py_BuildValue("(n)", n));
+    if (va == NULL || vb == NULL) {
+        Py_XDECREF(va);
+        Py_XDECREF(vb);
+        return NULL;
+    }
+    return Py_BuildValue("NN", va, vb);
+}
+
+#define DOUBLES(buffer) ((double*)PyBytes_AS_STRING(buffer))
+
+static PyObject* dropPoints(PyObject* self, PyObject* args) {
+    /* params of run */
     PyObject *wind, /* describe the wind:   '{degree}{nodes}KT'          */
         *vel,       /* velocity of UAV:   [radians, magnitude, v_down]   */
         *target,    /* GPS target position: [latitude, longitude]        */
@@ -347,96 +814,112 @@ static PyObject* trajectories(PyObject* self, PyObject* args) {
     int time,       /* Time of the simulation (in s)  */
         step;       /* Step of the simulation (in ms) */
     const char* integrator; /* integrator */
+    double tail_tol = 0;    /* terminal tail tolerance (m/s2), optional */
 
-    if (!PyArg_ParseTuple(args, "OOOOOfiis", &wind, &vel, &target, &h, &m, &CdS,
-                          &time, &step, &integrator)) {
+    if (!PyArg_ParseTuple(args, "OOOOOfiis|d", &wind, &vel, &target, &h, &m,
+                          &CdS, &time, &step, &integrator, &tail_tol)) {
         return NULL;
     }
 
-    /* check the objects */
-    {
-        int flag_wind = !PyList_Check(wind), flag_vel = !PyList_Check(vel),
-            flag_target = !PyList_Check(target), flag_h = !PyList_Check(h),
-            flag_m = !PyList_Check(m);
-        if (flag_wind || flag_vel || flag_target || flag_h || flag_m) {
-            return NULL;
-        }
-    }
+    /* check the objects and convert them */
+    Launches l;
+    if (parse_launches(wind, vel, target, h, m, &l) != 0) return NULL;
+    Py_ssize_t size = l.size;
 
-    /* check size */
-    Py_ssize_t size = 0;
-    if (size == 0)
-        size = PyList_GET_SIZE(wind);
-    else if (size != PyList_GET_SIZE(wind))
-        return NULL;
-    if (size == 0)
-        size = PyList_GET_SIZE(vel);
-    else if (size != PyList_GET_SIZE(vel))
-        return NULL;
-    if (size == 0)
-        size = PyList_GET_SIZE(target);
-    else if (size != PyList_GET_SIZE(target))
-        return NULL;
-    if (size == 0)
-        size = PyList_GET_SIZE(h);
-    else if (size != PyList_GET_SIZE(h))
-        return NULL;
-    if (size == 0)
-        size = PyList_GET_SIZE(m);
-    else if (size != PyList_GET_SIZE(m))
+    /* prepare output */
+    double* result = (double*)malloc((size + 1) * 2 * sizeof(double));
+    double* tail_err = (double*)malloc((size + 1) * sizeof(double));
+    if (result == NULL || tail_err == NULL) {
+        free(tail_err);
+        free(result);
+        free_launches(&l);
+        return PyErr_NoMemory();
+    }
+    int ret;
+    try {
+        ret = cxx_dropPoints((int)size, l.wind, l.vel, l.target, l.h, l.m, CdS,
+                             time, step / 1000., integrator, result, tail_tol,
+                             tail_err);
+    } catch (std::exception& e) {
+        /* bad integrator, or 'profile' with no profile loaded */
+        free(tail_err);
+        free(result);
+        free_launches(&l);
+        PyErr_SetString(PyExc_ValueError, e.what());
         return NULL;
-    if (size == 0) return NULL;
-
-    /* alloc memory */
-    double *c_wind = (double*)malloc(size * 2 * sizeof(double)),
-           *c_vel = (double*)malloc(size * 3 * sizeof(double)),
-           *c_target = (double*)malloc(size * 2 * sizeof(double)),
-           *c_h = (double*)malloc(size * sizeof(double)),
-           *c_m = (double*)malloc(size * sizeof(double));
-    if (c_wind == NULL || c_vel == NULL || c_target == NULL || c_h == NULL ||
-        c_m == NULL)
+    }
+    if (ret != 0) {
+        free(tail_err);
+        free(result);
+        free_launches(&l);
+        PyErr_SetString(PyExc_RuntimeError, "dropPoints failed");
         return NULL;
+    }
 
-    /* initialize memory */
+    /* convert result in List, with the tail error bound if it was enabled */
+    SFT_TRACE_SPAN("bridge", "convert");
+    PyObject* resultObj = PyList_New(size);
     for (Py_ssize_t i = 0; i < size; ++i) {
-        PyObject *item_wind = PyList_GET_ITEM(wind, i),
-                 *item_vel = PyList_GET_ITEM(vel, i),
-                 *item_target = PyList_GET_ITEM(target, i);
-        {
-            int angle_grad;
-            int speed_knots;
-            const char* str = PyUnicode_AsUTF8(item_wind);
-            sscanf(str, "%3d%2dKT", &angle_grad, &speed_knots);
-            c_wind[2 * i] = angle_grad * M_PI / 180.0;
-            c_wind[2 * i + 1] = speed_knots * KT2M;
-        }
-        if (!PyTuple_Check(item_vel) || PyTuple_GET_SIZE(item_vel) != 3)
-            return NULL;
-        c_vel[3 * i + 0] = PyFloat_AsDouble(PyTuple_GET_ITEM(item_vel, 0));
-        c_vel[3 * i + 1] = PyFloat_AsDouble(PyTuple_GET_ITEM(item_vel, 1));
-        c_vel[3 * i + 2] = PyFloat_AsDouble(PyTuple_GET_ITEM(item_vel, 2));
+        PyObject* item_result = PyTuple_New(tail_tol > 0 ? 3 : 2);
+        if (!item_result) return NULL;
+        PyTuple_SET_ITEM(item_result, 0, PyFloat_FromDouble(result[2 * i + 0]));
+        PyTuple_SET_ITEM(item_result, 1, PyFloat_FromDouble(result[2 * i + 1]));
+        if (tail_tol > 0)
+            PyTuple_SET_ITEM(item_result, 2, PyFloat_FromDouble(tail_err[i]));
+        PyList_SET_ITEM(resultObj, i, item_result);
+    }
 
-        if (!PyTuple_Check(item_target) || PyTuple_GET_SIZE(item_target) != 2)
-            return NULL;
-        c_target[2 * i + 0] =
-            PyFloat_AsDouble(PyTuple_GET_ITEM(item_target, 0));
-        c_target[2 * i + 1] =
-            PyFloat_AsDouble(PyTuple_GET_ITEM(item_target, 1));
+    free(tail_err);
+    free(result);
+    free_launches(&l);
+    return Py_BuildValue("O", resultObj);
+}
+
+static PyObject* trajectories(PyObject* self, PyObject* args) {
+   /* params of run */
+    PyObject *wind, /* describe the wind:   '{degree}{nodes}KT'          */
+        *vel,       /* velocity of UAV:   [radians, magnitude, v_down]   */
+        *target,    /* GPS target position: [latitude, longitude]        */
+        *h,         /* altitude of UAV (in m)                            */
+        *m;         /* Mass of payloads (in g)                           */
+    float CdS;      /* CdS coefficient of parachutes  */
+    int time,       /* Time of the simulation (in s)  */
+        step;       /* Step of the simulation (in ms) */
+    const char* integrator; /* integrator */
+    double tail_tol = 0;    /* terminal tail tolerance (m/s2), optional */
 
-        c_h[i] = PyFloat_AsDouble(PyList_GET_ITEM(h, i));
-        c_m[i] = PyFloat_AsDouble(PyList_GET_ITEM(m, i));
+    if (!PyArg_ParseTuple(args, "OOOOOfiis|d", &wind, &vel, &target, &h, &m,
+                          &CdS, &time, &step, &integrator, &tail_tol)) {
+        return NULL;
     }
 
+    /* check the objects and convert them */
+    Launches l;
+    if (parse_launches(wind, vel, target, h, m, &l) != 0) return NULL;
+    Py_ssize_t size = l.size;
+
     /* prepare output */
     double** result = (double**)malloc(size * sizeof(double*));
     if (result == NULL) return NULL;
     int* lengths = (int*)malloc(size*sizeof(int));
     if (lengths == NULL) return NULL;
-    int ret = cxx_trajectories((int)size, c_wind, c_vel, c_target, c_h, c_m, CdS, time,
-                      step / 1000., integrator, result, lengths);
+    int ret;
+    try {
+        ret = cxx_trajectories((int)size, l.wind, l.vel, l.target, l.h, l.m,
+                               CdS, time, step / 1000., integrator, result,
+                               lengths, tail_tol);
+    } catch (std::exception& e) {
+        /* bad integrator, or 'profile' with no profile loaded */
+        free(lengths);
+        free(result);
+        free_launches(&l);
+        PyErr_SetString(PyExc_ValueError, e.what());
+        return NULL;
+    }
     if (ret != 0) return NULL;
 
     /* convert result in List */
+    SFT_TRACE_SPAN("bridge", "convert");
     PyObject* resultObj = PyList_New(size);
     for (Py_ssize_t i = 0; i < size; ++i) {
         PyObject* item_result = PyTuple_New(lengths[i]);
@@ -458,16 +941,1357 @@ static PyObject* trajectories(PyObject* self, PyObject* args) {
     }
 
     free(result);
-    free(c_m);
-    free(c_h);
-    free(c_target);
-    free(c_vel);
-    free(c_wind);
+    free_launches(&l);
     return Py_BuildValue("O", resultObj);
 }
+static PyObject* trajectoryAt(PyObject* self, PyObject* args) {
+    /* params of run */
+    PyObject *wind, /* describe the wind:   '{degree}{nodes}KT'          */
+        *vel,       /* velocity of UAV:   [radians, magnitude, v_down]   */
+        *target,    /* GPS target position: [latitude, longitude]        */
+        *h,         /* altitude of UAV (in m)                            */
+        *m;         /* Mass of payloads (in g)                           */
+    float CdS;      /* CdS coefficient of parachutes  */
+    int time,       /* Time of the simulation (in s)  */
+        step;       /* Step of the simulation (in ms) */
+    const char* integrator; /* integrator */
+    const char* kind;       /* 'time' or 'altitude' */
+    PyObject* queries;      /* list of times (s) or altitudes (m) */
+
+    if (!PyArg_ParseTuple(args, "OOOOOfiissO", &wind, &vel, &target, &h, &m,
+                          &CdS, &time, &step, &integrator, &kind, &queries)) {
+        return NULL;
+    }
+    std::string kind_s = kind;
+    if (kind_s != "time" && kind_s != "altitude") {
+        PyErr_SetString(PyExc_ValueError, "kind must be 'time' or 'altitude'");
+        return NULL;
+    }
+    if (!PyList_Check(queries)) {
+        PyErr_SetString(PyExc_TypeError, "queries must be a list");
+        return NULL;
+    }
+
+    /* check the objects and convert them */
+    Launches l;
+    if (parse_launches(wind, vel, target, h, m, &l) != 0) return NULL;
+    Py_ssize_t size = l.size;
+    Py_ssize_t n_q = PyList_GET_SIZE(queries);
+
+    /* prepare output */
+    double* c_queries = (double*)malloc((n_q + 1) * sizeof(double));
+    double* result = (double*)malloc((size * n_q + 1) * 7 * sizeof(double));
+    int* found = (int*)malloc((size * n_q + 1) * sizeof(int));
+    if (c_queries == NULL || result == NULL || found == NULL) {
+        free(found);
+        free(result);
+        free(c_queries);
+        free_launches(&l);
+        return PyErr_NoMemory();
+    }
+    for (Py_ssize_t k = 0; k < n_q; ++k)
+        c_queries[k] = PyFloat_AsDouble(PyList_GET_ITEM(queries, k));
+
+    int ret = 1;
+    if (!PyErr_Occurred()) {
+        try {
+            ret = cxx_trajectoryAt((int)size, l.wind, l.vel, l.h, l.m, CdS,
+                                   time, step / 1000., integrator,
+                                   kind_s == "altitude", (int)n_q, c_queries,
+                                   result, found);
+        } catch (std::invalid_argument& e) {
+            PyErr_SetString(PyExc_ValueError, e.what());
+        } catch (std::exception& e) {
+            PyErr_SetString(PyExc_RuntimeError, e.what());
+        }
+    }
+
+    /* convert result in List, None where the altitude is never crossed */
+    PyObject* resultObj = ret == 0 ? PyList_New(size) : NULL;
+    for (Py_ssize_t i = 0; resultObj && i < size; ++i) {
+        PyObject* item_result = PyTuple_New(n_q);
+        if (!item_result) {
+            Py_CLEAR(resultObj);
+            break;
+        }
+        for (Py_ssize_t k = 0; k < n_q; ++k) {
+            Py_ssize_t q = i * n_q + k;
+            if (!found[q]) {
+                Py_INCREF(Py_None);
+                PyTuple_SET_ITEM(item_result, k, Py_None);
+                continue;
+            }
+            PyTuple_SET_ITEM(item_result, k,
+                             Py_BuildValue("(ddddddd)", result[7 * q + 0],
+                                           result[7 * q + 1], -result[7 * q + 2],
+                                           result[7 * q + 3], result[7 * q + 4],
+                                           -result[7 * q + 5], result[7 * q + 6]));
+        }
+        PyList_SET_ITEM(resultObj, i, item_result);
+    }
+
+    free(found);
+    free(result);
+    free(c_queries);
+    free_launches(&l);
+    return resultObj;
+}
+static PyObject* gps_tuple(const GPS& gps) {
+    return Py_BuildValue("(dd)", gps.lat, gps.lon);
+}
+
+static PyObject* dropWindow(PyObject* self, PyObject* args) {
+    /* params of run */
+    const char* wind;       /* describe the wind: '{degree}{nodes}KT'        */
+    FlightLine line;        /* start, heading (rad), speed, v_down, length   */
+    PyObject* profile;      /* altitude (m) or list of (s (m), altitude (m)) */
+    GPS target;             /* GPS target position                           */
+    double radius,          /* acceptance radius (m)                         */
+        m,                  /* mass of the payload (kg)                      */
+        way_d = 0;          /* waypoints distance (m), optional              */
+    float CdS;              /* CdS coefficient of parachutes  */
+    int time,               /* Time of the simulation (in s)  */
+        step;               /* Step of the simulation (in ms) */
+    const char* integrator; /* integrator */
+
+    if (!PyArg_ParseTuple(args, "s(dd)dddOd(dd)ddfiis|d", &wind,
+                          &line.start.lat, &line.start.lon, &line.heading,
+                          &line.speed, &line.v_down, &profile, &line.length,
+                          &target.lat, &target.lon, &radius, &m, &CdS, &time,
+                          &step, &integrator, &way_d)) {
+        return NULL;
+    }
+
+    /* altitude profile */
+    if (PyList_Check(profile)) {
+        for (Py_ssize_t i = 0; i < PyList_GET_SIZE(profile); ++i) {
+            double s_i, h_i;
+            if (!PyArg_ParseTuple(PyList_GET_ITEM(profile, i), "dd", &s_i,
+                                  &h_i)) {
+                return NULL;
+            }
+            line.profile.push_back({s_i, h_i});
+        }
+        std::sort(line.profile.begin(), line.profile.end());
+    } else {
+        double h_c = PyFloat_AsDouble(profile);
+        if (PyErr_Occurred()) return NULL;
+        line.profile.push_back({0, h_c});
+    }
+    if (line.profile.empty() || line.length <= 0) {
+        PyErr_SetString(PyExc_ValueError,
+                        "empty altitude profile or length <= 0");
+        return NULL;
+    }
+
+    int angle_grad = 0, speed_knots = 0;
+    sscanf(wind, "%3d%2dKT", &angle_grad, &speed_knots);
+    double c_wind[2] = {angle_grad * M_PI / 180.0, speed_knots * KT2M};
+
+    DropWindow w;
+    int ret;
+    try {
+        ret = cxx_dropWindow(line, target, radius, c_wind, m, CdS, time,
+                             step / 1000., integrator, way_d, &w);
+    } catch (std::exception& e) {
+        /* bad integrator, flight line or profile */
+        PyErr_SetString(PyExc_ValueError, e.what());
+        return NULL;
+    }
+    if (ret != 0) return NULL;
+
+    /* (found, (s_begin, s_end), (begin, end), waypoints, (s_best, miss)) */
+    PyObject* waypoints = PyList_New(0);
+    if (waypoints == NULL) return NULL;
+    for (const GPS& wp : w.waypoints) {
+        PyObject* item = gps_tuple(wp);
+        if (item == NULL || PyList_Append(waypoints, item) != 0) {
+            Py_XDECREF(item);
+            Py_DECREF(waypoints);
+            return NULL;
+        }
+        Py_DECREF(item);
+    }
+    if (!w.found) {
+        return Py_BuildValue("ONNN(dd)", Py_False, Py_NewRef(Py_None),
+                             Py_NewRef(Py_None), waypoints, w.s_best,
+                             w.miss_best);
+    }
+    return Py_BuildValue("O(dd)(NN)N(dd)", Py_True, w.s_begin, w.s_end,
+                         gps_tuple(w.begin), gps_tuple(w.end), waypoints,
+                         w.s_best, w.miss_best);
+}
+
+static PyObject* rankHeadings(PyObject* self, PyObject* args) {
+    /* params of run */
+    const char* wind;       /* describe the wind: '{degree}{nodes}KT' */
+    GPS target;             /* GPS target position                    */
+    ApproachConditions cond;
+    DropUncertainty unc;    /* (wind speed (m/s), wind direction (rad), CdS
+                               (m2), mass (kg), release timing (s)) */
+    float CdS;              /* CdS coefficient of parachutes  */
+    int n_headings,         /* num of candidate headings      */
+        time,               /* Time of the simulation (in s)  */
+        step;               /* Step of the simulation (in ms) */
+    const char* integrator; /* integrator */
+    double way_d = 100;     /* waypoints distance (m), optional */
+
+    if (!PyArg_ParseTuple(args, "s(dd)ddddf(ddddd)iiis|d", &wind, &target.lat,
+                          &target.lon, &cond.h, &cond.speed, &cond.v_down,
+                          &cond.mass, &CdS, &unc.wind_speed, &unc.wind_dir,
+                          &unc.cds, &unc.mass, &unc.delay, &n_headings, &time,
+                          &step, &integrator, &way_d)) {
+        return NULL;
+    }
+    if (n_headings < 1) {
+        PyErr_SetString(PyExc_ValueError, "n_headings must be >= 1");
+        return NULL;
+    }
+    cond.cds = CdS;
+    int angle_grad = 0, speed_knots = 0;
+    sscanf(wind, "%3d%2dKT", &angle_grad, &speed_knots);
+    cond.wind_dir = angle_grad * M_PI / 180.0;
+    cond.wind_speed = speed_knots * KT2M;
+
+    std::vector<HeadingCandidate> cand;
+    int ret;
+    try {
+        ret = cxx_rankHeadings(target, cond, unc, n_headings, time,
+                               step / 1000., integrator, way_d, &cand);
+    } catch (std::invalid_argument& e) {
+        PyErr_SetString(PyExc_ValueError, e.what());
+        return NULL;
+    } catch (std::exception& e) {
+        PyErr_SetString(PyExc_RuntimeError, e.what());
+        return NULL;
+    }
+    if (ret != 0) return NULL;
+
+    /* (heading, release, rms, (major, minor, angle), waypoints) */
+    PyObject* resultObj = PyList_New(cand.size());
+    if (resultObj == NULL) return NULL;
+    for (size_t i = 0; i < cand.size(); ++i) {
+        const HeadingCandidate& c = cand[i];
+        PyObject* item = Py_BuildValue(
+            "dNd(ddd)[NNN]", c.heading, gps_tuple(c.release), c.spread.rms(),
+            c.spread.major(), c.spread.minor(), c.spread.angle(),
+            gps_tuple(c.waypoints[0]), gps_tuple(c.waypoints[1]),
+            gps_tuple(c.waypoints[2]));
+        if (item == NULL) {
+            Py_DECREF(resultObj);
+            return NULL;
+        }
+        PyList_SET_ITEM(resultObj, i, item);
+    }
+    return resultObj;
+}
+
+/* mean (7) and covariance (7x7, row-major) buffers of a DropDistribution,
+   0 = ok, -1 = error (python exception set) */
+static int parse_distribution(PyObject* mean_obj, PyObject* cov_obj,
+                              DropDistribution* dist) {
+    const int n = DropDistribution::N_INPUTS;
+    Py_buffer views[2];
+    PyObject* objs[2] = {mean_obj, cov_obj};
+    for (int i = 0; i < 2; ++i) {
+        if (get_doubles(objs[i], &views[i]) != 0) {
+            if (i == 1) PyBuffer_Release(&views[0]);
+            return -1;
+        }
+    }
+    bool sizes_ok = views[0].len == n * (Py_ssize_t)sizeof(double) &&
+                    views[1].len == n * n * (Py_ssize_t)sizeof(double);
+    if (sizes_ok) {
+        const double* mean = (const double*)views[0].buf;
+        const double* cov = (const double*)views[1].buf;
+        for (int i = 0; i < n; ++i) {
+            dist->mean[i] = mean[i];
+            for (int j = 0; j < n; ++j) dist->cov[i][j] = cov[n * i + j];
+        }
+    }
+    release_doubles(views, 2);
+    if (!sizes_ok) {
+        PyErr_SetString(PyExc_ValueError,
+                        "mean must have 7 values and cov 49");
+        return -1;
+    }
+    return 0;
+}
+
+static PyObject* spread_tuple(const LandingSpread& sp) {
+    return Py_BuildValue("(dddddddd)", sp.n, sp.e, sp.c_nn, sp.c_ne, sp.c_ee,
+                         sp.major(), sp.minor(), sp.angle());
+}
+
+static PyObject* dispersion(PyObject* self, PyObject* args) {
+    /* params of run */
+    DropDistribution dist;
+    PyObject* objs[2];      /* mean (7) and covariance (7x7, row-major) of
+                               (wind N, wind E, CdS, mass, vel N, vel E,
+                               vel D), buffers of doubles */
+    int time,               /* Time of the simulation (in s)  */
+        step;               /* Step of the simulation (in ms) */
+    const char* integrator; /* integrator */
+    const char* mode = "ut"; /* 'ut', 'mc' or 'validate', optional */
+    int n_mc = 10000;       /* num of Monte Carlo drops, optional */
+    unsigned int seed = 0;  /* seed of Monte Carlo, optional */
+
+    if (!PyArg_ParseTuple(args, "dOOiis|siI", &dist.h, &objs[0], &objs[1],
+                          &time, &step, &integrator, &mode, &n_mc, &seed)) {
+        return NULL;
+    }
+    std::string mode_s = mode;
+    if (mode_s != "ut" && mode_s != "mc" && mode_s != "validate") {
+        PyErr_SetString(PyExc_ValueError,
+                        "mode must be 'ut', 'mc' or 'validate'");
+        return NULL;
+    }
+    if (mode_s != "ut" && n_mc < 2) {
+        PyErr_SetString(PyExc_ValueError, "n_mc must be >= 2");
+        return NULL;
+    }
+
+    if (parse_distribution(objs[0], objs[1], &dist) != 0) return NULL;
+
+    LandingSpread ut, mc;
+    int ret;
+    try {
+        ret = cxx_dispersion(dist, time, step / 1000., integrator,
+                             mode_s != "mc" ? &ut : NULL,
+                             mode_s != "ut" ? &mc : NULL, n_mc, seed);
+    } catch (std::invalid_argument& e) {
+        PyErr_SetString(PyExc_ValueError, e.what());
+        return NULL;
+    }
+    if (ret != 0) return NULL;
+
+    /* (N, E, cov NN, cov NE, cov EE, major, minor, angle) */
+    if (mode_s == "ut") return spread_tuple(ut);
+    if (mode_s == "mc") return spread_tuple(mc);
+    return Py_BuildValue("(NN)", spread_tuple(ut), spread_tuple(mc));
+}
+
+static PyObject* anytime_tuple(const AnytimeResult& r) {
+    PyObject* spread = r.level == AnytimeLevel::DISPERSION
+                           ? spread_tuple(r.spread)
+                           : Py_NewRef(Py_None);
+    return Py_BuildValue("(s(dd)dNdO)", level_name(r.level), r.north, r.east,
+                         r.error, spread, r.elapsed_us / 1000.,
+                         r.cancelled ? Py_True : Py_False);
+}
+
+static PyObject* anytimeDrop(PyObject* self, PyObject* args) {
+    /* params of run */
+    AnytimeQuery q;
+    PyObject *mean, *cov;   /* see dispersion, a zero covariance skips the
+                               dispersion level */
+    int time;               /* Time of the simulation (in s)  */
+    double step,            /* Step of the fine run (in ms), the coarse one
+                               is 10 times longer */
+        budget;             /* Time budget (in ms) */
+    const char* integrator; /* integrator */
+    PyObject* callback = NULL; /* called with the tuple of each level,
+                                  optional */
+
+    if (!PyArg_ParseTuple(args, "dOOidds|O", &q.dist.h, &mean, &cov, &time,
+                          &step, &budget, &integrator, &callback)) {
+        return NULL;
+    }
+    if (callback == Py_None) callback = NULL;
+    if (callback != NULL && !PyCallable_Check(callback)) {
+        PyErr_SetString(PyExc_TypeError, "callback must be callable");
+        return NULL;
+    }
+    if (step <= 0) {
+        PyErr_SetString(PyExc_ValueError, "step must be > 0");
+        return NULL;
+    }
+    if (parse_distribution(mean, cov, &q.dist) != 0) return NULL;
+    q.T = time;
+    q.dt_fine = step / 1000.;
+    q.dt_coarse = 10 * q.dt_fine;
+    q.method = integrator;
+
+    /* The first exception of the callback is raised once the query is over,
+       the levels after it are not reported */
+    bool failed = false;
+    auto on_level = [&](const AnytimeResult& r) {
+        if (callback == NULL || failed) return;
+        PyObject* level = anytime_tuple(r);
+        if (level == NULL) {
+            failed = true;
+            return;
+        }
+        PyObject* ret = PyObject_CallOneArg(callback, level);
+        Py_DECREF(level);
+        if (ret == NULL) {
+            failed = true;
+        } else {
+            Py_DECREF(ret);
+        }
+    };
+
+    AnytimeResult result;
+    try {
+        cxx_anytimeDrop(q, budget / 1000., on_level, &result);
+    } catch (std::invalid_argument& e) {
+        PyErr_SetString(PyExc_ValueError, e.what());
+        return NULL;
+    }
+    if (failed) return NULL;
+
+    /* (level, (N, E), error m, spread or None, elapsed ms, cancelled) */
+    return anytime_tuple(result);
+}
+
+static PyObject* qmcMean(PyObject* self, PyObject* args) {
+    /* params of run */
+    DropDistribution dist;
+    PyObject *mean, *cov;   /* see dispersion */
+    int n_runs,             /* num of simulations             */
+        time,               /* Time of the simulation (in s)  */
+        step;               /* Step of the simulation (in ms) */
+    const char* integrator; /* integrator */
+    const char* kind = "mc"; /* 'mc', 'sobol' or 'halton', optional */
+    int antithetic = 0,     /* mirrored pairs, optional */
+        cv = 0;             /* analytic control variate, optional */
+    unsigned int seed = 0;  /* seed of the samples, optional */
+
+    if (!PyArg_ParseTuple(args, "dOOiiis|sppI", &dist.h, &mean, &cov, &n_runs,
+                          &time, &step, &integrator, &kind, &antithetic, &cv,
+                          &seed)) {
+        return NULL;
+    }
+    SamplingOptions opt;
+    std::string kind_s = kind;
+    if (kind_s == "mc") {
+        opt.kind = Sampling::MC;
+    } else if (kind_s == "sobol") {
+        opt.kind = Sampling::SOBOL;
+    } else if (kind_s == "halton") {
+        opt.kind = Sampling::HALTON;
+    } else {
+        PyErr_SetString(PyExc_ValueError,
+                        "kind must be 'mc', 'sobol' or 'halton'");
+        return NULL;
+    }
+    opt.antithetic = antithetic;
+    opt.control_variate = cv;
+    opt.seed = seed;
+    if (parse_distribution(mean, cov, &dist) != 0) return NULL;
+
+    MeanEstimate est;
+    try {
+        /* with the GIL, it reads the profile */
+        ODESettings cfg = sim_settings(step / 1000., time, integrator);
+        ReleaseGIL nogil;
+        cxx_qmcMean(dist, n_runs, cfg, opt, &est);
+    } catch (std::exception& e) {
+        PyErr_SetString(PyExc_ValueError, e.what());
+        return NULL;
+    }
+    /* (N, E, se N, se E, runs) */
+    return Py_BuildValue("(ddddn)", est.n, est.e, est.se_n, est.se_e,
+                         (Py_ssize_t)est.runs);
+}
+
+static PyObject* qmcConvergence(PyObject* self, PyObject* args) {
+    /* params of run */
+    DropDistribution dist;
+    PyObject *mean, *cov;   /* see dispersion */
+    int n_min,              /* simulations of the first point */
+        n_max,              /* simulations of the last point  */
+        time,               /* Time of the simulation (in s)  */
+        step;               /* Step of the simulation (in ms) */
+    const char* integrator; /* integrator */
+    unsigned int seed = 0;  /* seed of the samples, optional */
+
+    if (!PyArg_ParseTuple(args, "dOOiiiis|I", &dist.h, &mean, &cov, &n_min,
+                          &n_max, &time, &step, &integrator, &seed)) {
+        return NULL;
+    }
+    if (parse_distribution(mean, cov, &dist) != 0) return NULL;
+
+    std::vector<ConvergencePoint> curve;
+    try {
+        /* with the GIL, it reads the profile */
+        ODESettings cfg = sim_settings(step / 1000., time, integrator);
+        ReleaseGIL nogil;
+        cxx_qmcConvergence(dist, n_min, n_max, cfg, seed, &curve);
+    } catch (std::exception& e) {
+        PyErr_SetString(PyExc_ValueError, e.what());
+        return NULL;
+    }
+
+    /* (method, runs, N, E, se N, se E) */
+    PyObject* resultObj = PyList_New(curve.size());
+    if (resultObj == NULL) return NULL;
+    for (size_t i = 0; i < curve.size(); ++i) {
+        const MeanEstimate& est = curve[i].est;
+        PyObject* item = Py_BuildValue(
+            "(sndddd)", curve[i].method.c_str(), (Py_ssize_t)est.runs, est.n,
+            est.e, est.se_n, est.se_e);
+        if (item == NULL) {
+            Py_DECREF(resultObj);
+            return NULL;
+        }
+        PyList_SET_ITEM(resultObj, i, item);
+    }
+    return resultObj;
+}
+
+static PyObject* sobolIndices(PyObject* self, PyObject* args) {
+    /* params of run, launches as in dropPoints */
+    PyObject *wind, /* describe the wind:   '{degree}{nodes}KT'          */
+        *vel,       /* velocity of UAV:   [radians, magnitude, v_down]   */
+        *target,    /* GPS target position: [latitude, longitude]        */
+        *h,         /* altitude of UAV (in m)                            */
+        *m;         /* Mass of payloads (in g)                           */
+    float CdS;      /* CdS coefficient of parachutes  */
+    double sd[DropDistribution::N_INPUTS]; /* 1-sigma of (wind N, wind E,
+                                              CdS, mass, vel N, vel E,
+                                              vel D) */
+    int n,          /* base sample size               */
+        time,       /* Time of the simulation (in s)  */
+        step;       /* Step of the simulation (in ms) */
+    const char* integrator; /* integrator */
+    unsigned int seed = 0;  /* seed of the Sobol points, optional */
+
+    if (!PyArg_ParseTuple(args, "OOOOOf(ddddddd)iiis|I", &wind, &vel, &target,
+                          &h, &m, &CdS, &sd[0], &sd[1], &sd[2], &sd[3],
+                          &sd[4], &sd[5], &sd[6], &n, &time, &step,
+                          &integrator, &seed)) {
+        return NULL;
+    }
+    if (n < 2) {
+        PyErr_SetString(PyExc_ValueError, "n must be >= 2");
+        return NULL;
+    }
+
+    /* check the objects and convert them */
+    Launches l;
+    if (parse_launches(wind, vel, target, h, m, &l) != 0) return NULL;
+    Py_ssize_t size = l.size;
+
+    std::vector<SobolIndices> result(size);
+    int ret;
+    try {
+        /* with the GIL, it reads the profile */
+        ODESettings cfg = sim_settings(step / 1000., time, integrator);
+        ReleaseGIL nogil;
+        ret = cxx_sobolIndices((int)size, l.wind, l.vel, l.h, l.m, CdS, sd, n,
+                               cfg, seed, result.data());
+    } catch (std::invalid_argument& e) {
+        free_launches(&l);
+        PyErr_SetString(PyExc_ValueError, e.what());
+        return NULL;
+    } catch (std::exception& e) {
+        free_launches(&l);
+        PyErr_SetString(PyExc_RuntimeError, e.what());
+        return NULL;
+    }
+    free_launches(&l);
+    if (ret != 0) {
+        PyErr_SetString(PyExc_RuntimeError, "sobolIndices failed");
+        return NULL;
+    }
+
+    /* ((first N), (total N), (first E), (total E)) per launch, 7 inputs */
+    PyObject* resultObj = PyList_New(size);
+    if (resultObj == NULL) return NULL;
+    for (Py_ssize_t i = 0; i < size; ++i) {
+        const SobolIndices& r = result[i];
+        PyObject* parts[4];
+        const DropDistribution::Vector* vs[4] = {&r.first_n, &r.total_n,
+                                                 &r.first_e, &r.total_e};
+        for (int k = 0; k < 4; ++k) {
+            const auto& v = *vs[k];
+            parts[k] = Py_BuildValue("(ddddddd)", v[0], v[1], v[2], v[3],
+                                     v[4], v[5], v[6]);
+        }
+        PyObject* item = Py_BuildValue("(NNNN)", parts[0], parts[1], parts[2],
+                                       parts[3]);
+        if (item == NULL) {
+            Py_DECREF(resultObj);
+            return NULL;
+        }
+        PyList_SET_ITEM(resultObj, i, item);
+    }
+    return resultObj;
+}
+
+static PyObject* windInversion(PyObject* self, PyObject* args) {
+    /* params of run, launches as in dropPoints with the landing as target */
+    PyObject *wind, /* reported wind, first guess: '{degree}{nodes}KT'   */
+        *vel,       /* velocity of UAV:   [radians, magnitude, v_down]   */
+        *land,      /* GPS landing position: [latitude, longitude]       */
+        *h,         /* altitude of UAV (in m)                            */
+        *m,         /* Mass of payloads (in g)                           */
+        *drop;      /* GPS release position: [latitude, longitude]       */
+    WindInversionOptions opt;
+    int time,       /* Time of the simulation (in s)  */
+        step;       /* Step of the simulation (in ms) */
+    const char* integrator; /* integrator */
+
+    /* sigma_land: 1-sigma of the logged landing (m), optional */
+    if (!PyArg_ParseTuple(args, "OOOOOdOiis|d", &wind, &vel, &land, &h, &m,
+                          &opt.cds, &drop, &time, &step, &integrator,
+                          &opt.sigma_land)) {
+        return NULL;
+    }
+
+    /* check the objects and convert them */
+    Launches l;
+    if (parse_launches(wind, vel, land, h, m, &l) != 0) return NULL;
+    Py_ssize_t size = l.size;
+    if (!PyList_Check(drop) || PyList_GET_SIZE(drop) != size) {
+        free_launches(&l);
+        PyErr_SetString(PyExc_ValueError,
+                        "drop must be a list as long as the launches");
+        return NULL;
+    }
+    std::vector<double> drop_v(2 * size);
+    for (Py_ssize_t i = 0; i < size; ++i) {
+        if (!PyArg_ParseTuple(PyList_GET_ITEM(drop, i), "dd", &drop_v[2 * i],
+                              &drop_v[2 * i + 1])) {
+            free_launches(&l);
+            return NULL;
+        }
+    }
+
+    std::vector<WindFit> result;
+    LandingSpread errors;
+    int ret;
+    try {
+        /* with the GIL, it reads the profile */
+        ODESettings cfg = sim_settings(step / 1000., time, integrator);
+        ReleaseGIL nogil;
+        ret = cxx_windInversion((int)size, l.wind, l.vel, l.target,
+                                drop_v.data(), l.h, l.m, opt, cfg, &result,
+                                &errors);
+    } catch (std::invalid_argument& e) {
+        free_launches(&l);
+        PyErr_SetString(PyExc_ValueError, e.what());
+        return NULL;
+    } catch (std::exception& e) {
+        free_launches(&l);
+        PyErr_SetString(PyExc_RuntimeError, e.what());
+        return NULL;
+    }
+    free_launches(&l);
+    if (ret != 0) {
+        PyErr_SetString(PyExc_RuntimeError, "windInversion failed");
+        return NULL;
+    }
+
+    /* ((N, E) m/s, (cov NN, cov NE, cov EE), residual m, iterations,
+       converged) per launch, and the spread of fitted minus reported wind */
+    PyObject* resultObj = PyList_New(size);
+    if (resultObj == NULL) return NULL;
+    for (Py_ssize_t i = 0; i < size; ++i) {
+        const WindFit& f = result[i];
+        PyObject* item = Py_BuildValue(
+            "((dd)(ddd)dIO)", f.wind_n, f.wind_e, f.c_nn, f.c_ne, f.c_ee,
+            f.residual, f.iterations, f.converged ? Py_True : Py_False);
+        if (item == NULL) {
+            Py_DECREF(resultObj);
+            return NULL;
+        }
+        PyList_SET_ITEM(resultObj, i, item);
+    }
+    return Py_BuildValue("(NN)", resultObj, spread_tuple(errors));
+}
+
+static PyObject* autotuneIntegrator(PyObject* self, PyObject* args) {
+    /* params of run, launches as in dropPoints */
+    PyObject *wind, /* describe the wind:   '{degree}{nodes}KT'          */
+        *vel,       /* velocity of UAV:   [radians, magnitude, v_down]   */
+        *target,    /* GPS target position: [latitude, longitude]        */
+        *h,         /* altitude of UAV (in m)                            */
+        *m;         /* Mass of payloads (in g)                           */
+    double CdS;     /* CdS coefficient of parachutes  */
+    AutotuneOptions opt;    /* tol: landing error allowed (in m) */
+    int time;               /* Time of the simulation (in s)  */
+    const char* path = NULL; /* file to save the profile to, optional */
+
+    if (!PyArg_ParseTuple(args, "OOOOOddi|z", &wind, &vel, &target, &h, &m,
+                          &CdS, &opt.tol, &time, &path)) {
+        return NULL;
+    }
+    if (opt.tol <= 0 || time <= 0) {
+        PyErr_SetString(PyExc_ValueError, "tol and time must be > 0");
+        return NULL;
+    }
+    opt.T = time;
+
+    /* check the objects and convert them */
+    Launches l;
+    if (parse_launches(wind, vel, target, h, m, &l) != 0) return NULL;
+
+    AutotuneResult result;
+    int ret;
+    try {
+        ReleaseGIL nogil;
+        ret = cxx_autotune((int)l.size, l.wind, l.vel, l.h, l.m, CdS, opt,
+                           &result);
+    } catch (std::invalid_argument& e) {
+        free_launches(&l);
+        PyErr_SetString(PyExc_ValueError, e.what());
+        return NULL;
+    } catch (std::exception& e) {
+        free_launches(&l);
+        PyErr_SetString(PyExc_RuntimeError, e.what());
+        return NULL;
+    }
+    free_launches(&l);
+    if (ret != 0) {
+        PyErr_SetString(PyExc_RuntimeError, "autotuneIntegrator failed");
+        return NULL;
+    }
+    if (!result.found) {
+        PyErr_Format(PyExc_ValueError,
+                     "no setting lands within %g m of the reference", opt.tol);
+        return NULL;
+    }
+    if (path != NULL) {
+        try {
+            write_profile(path, result, opt.tol);
+        } catch (std::exception& e) {
+            PyErr_SetString(PyExc_OSError, e.what());
+            return NULL;
+        }
+    }
+
+    /* (integrator, step ms, tail_tol, worst error m, us per run), and
+       the same with the rms error for every setting tried */
+    PyObject* tried = PyList_New(result.tried.size());
+    if (tried == NULL) return NULL;
+    for (size_t i = 0; i < result.tried.size(); ++i) {
+        const TuneCandidate& c = result.tried[i];
+        PyList_SET_ITEM(tried, i,
+                        Py_BuildValue("(sddddd)", c.method.c_str(),
+                                      c.dt * 1000., c.tail_tol, c.err_max,
+                                      c.err_rms, c.us_per_run));
+    }
+    const TuneCandidate& c = result.chosen;
+    return Py_BuildValue("((sdddd)N)", c.method.c_str(), c.dt * 1000.,
+                         c.tail_tol, c.err_max, c.us_per_run, tried);
+}
+
+static PyObject* loadProfile(PyObject* self, PyObject* args) {
+    const char* path; /* profile saved by autotuneIntegrator */
+    if (!PyArg_ParseTuple(args, "s", &path)) return NULL;
+    ODESettings cfg;
+    try {
+        cfg = read_profile(path);
+        Simulation check(cfg); /* throws if invalid */
+    } catch (std::exception& e) {
+        PyErr_SetString(PyExc_ValueError, e.what());
+        return NULL;
+    }
+    profile = std::make_unique<ODESettings>(cfg);
+    /* (integrator, step ms, tail_tol) used with integrator 'profile' */
+    return Py_BuildValue("(sdd)", cfg.method.c_str(), cfg.dt * 1000.,
+                         cfg.tail_tol);
+}
+
+static PyObject* setDropCache(PyObject* self, PyObject* args) {
+    Py_ssize_t capacity;   /* max entries, 0 = cache off            */
+    Py_ssize_t shards = 16; /* num of lock striped shards, optional */
+    CacheTolerances tol;    /* quantization steps, optional         */
+
+    if (!PyArg_ParseTuple(args, "n|n(ddddddddd)", &capacity, &shards, &tol.h,
+                          &tol.speed, &tol.heading, &tol.v_down,
+                          &tol.wind_speed, &tol.wind_dir, &tol.mass, &tol.cds,
+                          &tol.dt)) {
+        return NULL;
+    }
+    if (capacity < 0 || shards < 1) {
+        PyErr_SetString(PyExc_ValueError,
+                        "capacity must be >= 0 and shards >= 1");
+        return NULL;
+    }
+    if (capacity == 0) {
+        drop_cache.reset();
+    } else {
+        drop_cache = std::make_unique<DropCache>(capacity, shards, tol);
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject* dropCacheStats(PyObject* self, PyObject* args) {
+    DropCache::Stats st;
+    if (drop_cache) st = drop_cache->stats();
+    return Py_BuildValue("(KKnn)", (unsigned long long)st.hits,
+                         (unsigned long long)st.misses, (Py_ssize_t)st.size,
+                         (Py_ssize_t)st.capacity);
+}
+
+static PyObject* clearDropCache(PyObject* self, PyObject* args) {
+    if (drop_cache) drop_cache->clear();
+    Py_RETURN_NONE;
+}
+
+static PyObject* dropSweep(PyObject* self, PyObject* args) {
+    /* params of run */
+    PyObject* axes[DropSweep::N_AXES]; /* (lo, hi, n) of h (m), V (m/s),
+                                          heading (rad), wind speed (m/s),
+                                          wind heading (rad), mass (kg) */
+    double v_down;          /* vertical speed of UAV (m/s)    */
+    float CdS;              /* CdS coefficient of parachutes  */
+    int time,               /* Time of the simulation (in s)  */
+        step;               /* Step of the simulation (in ms) */
+    const char* integrator; /* integrator */
+
+    if (!PyArg_ParseTuple(args, "OOOOOOdfiis", &axes[0], &axes[1], &axes[2],
+                          &axes[3], &axes[4], &axes[5], &v_down, &CdS, &time,
+                          &step, &integrator)) {
+        return NULL;
+    }
+
+    DropSweep sweep;
+    Py_ssize_t size = 1; /* combinations, checked against the buffer size */
+    for (int i = 0; i < DropSweep::N_AXES; ++i) {
+        SweepAxis& ax = sweep.axes[i];
+        Py_ssize_t n;
+        if (!PyTuple_Check(axes[i]) ||
+            !PyArg_ParseTuple(axes[i], "ddn", &ax.lo, &ax.hi, &n)) {
+            PyErr_SetString(PyExc_TypeError, "axis must be (lo, hi, n)");
+            return NULL;
+        }
+        if (n < 1) {
+            PyErr_SetString(PyExc_ValueError, "axis must have n >= 1");
+            return NULL;
+        }
+        if (n > PY_SSIZE_T_MAX / (Py_ssize_t)(3 * sizeof(double)) / size) {
+            PyErr_SetString(PyExc_OverflowError, "sweep too large");
+            return NULL;
+        }
+        size *= n;
+        ax.n = n;
+    }
+    sweep.v_down = v_down;
+    sweep.cds = CdS;
+
+    /* the result is written straight in the buffer of the returned array */
+    PyObject* buffer = PyBytes_FromStringAndSize(NULL, size * 3 * sizeof(double));
+    if (buffer == NULL) return NULL;
+    int ret;
+    try {
+        /* with the GIL, it reads the profile */
+        ODESettings cfg = sim_settings(step / 1000., time, integrator);
+        ReleaseGIL nogil;
+        ret = cxx_dropSweep(sweep, cfg, (double*)PyBytes_AS_STRING(buffer));
+    } catch (std::invalid_argument& e) {
+        Py_DECREF(buffer);
+        PyErr_SetString(PyExc_ValueError, e.what());
+        return NULL;
+    } catch (std::exception& e) {
+        Py_DECREF(buffer);
+        PyErr_SetString(PyExc_RuntimeError, e.what());
+        return NULL;
+    }
+    if (ret != 0) {
+        Py_DECREF(buffer);
+        PyErr_SetString(PyExc_RuntimeError, "dropSweep failed");
+        return NULL;
+    }
+
+    /* dense N-D view: shape = (n_h, n_V, n_heading, n_wspeed, n_whead, n_m, 3) */
+    PyObject* view = PyMemoryView_FromObject(buffer);
+    Py_DECREF(buffer);
+    if (view == NULL) return NULL;
+    auto shape = sweep.shape();
+    PyObject* resultObj = PyObject_CallMethod(
+        view, "cast", "s(nnnnnni)", "d", shape[0], shape[1], shape[2],
+        shape[3], shape[4], shape[5], 3);
+    Py_DECREF(view);
+    return resultObj;
+}
+
+/* frame conversions around a single target: kind 0 = toGPS, 1 = toENU,
+   2 = dropGPS */
+static PyObject* frame_batch(PyObject* args, int kind) {
+    double lat0, lon0;
+    PyObject* objs[2];
+    if (!PyArg_ParseTuple(args, "ddOO", &lat0, &lon0, &objs[0], &objs[1]))
+        return NULL;
+    Py_buffer views[2];
+    Py_ssize_t n = get_doubles_n(objs, views, 2);
+    if (n < 0) return NULL;
+
+    PyObject* a = PyBytes_FromStringAndSize(NULL, n * sizeof(double));
+    PyObject* b = PyBytes_FromStringAndSize(NULL, n * sizeof(double));
+    if (a != NULL && b != NULL) {
+        GeoFrame frame({lat0, lon0});
+        const double *x = (const double*)views[0].buf,
+                     *y = (const double*)views[1].buf;
+        if (kind == 0)
+            frame.to_gps(x, y, n, DOUBLES(a), DOUBLES(b));
+        else if (kind == 1)
+            frame.to_enu(x, y, n, DOUBLES(a), DOUBLES(b));
+        else
+            get_drop_batch(frame, x, y, n, DOUBLES(a), DOUBLES(b));
+    }
+    release_doubles(views, 2);
+    if (a == NULL || b == NULL) {
+        Py_XDECREF(a);
+        Py_XDECREF(b);
+        return NULL;
+    }
+    return doubles_pair(a, b, n);
+}
+
+static PyObject* toGPS(PyObject* self, PyObject* args) {
+    return frame_batch(args, 0);
+}
+
+static PyObject* toENU(PyObject* self, PyObject* args) {
+    return frame_batch(args, 1);
+}
+
+static PyObject* dropGPS(PyObject* self, PyObject* args) {
+    return frame_batch(args, 2);
+}
+
+static PyObject* translateGPS(PyObject* self, PyObject* args) {
+    PyObject* objs[4]; /* lat (deg), lon (deg), d (m), head (rad) */
+    if (!PyArg_ParseTuple(args, "OOOO", &objs[0], &objs[1], &objs[2],
+                          &objs[3]))
+        return NULL;
+    Py_buffer views[4];
+    Py_ssize_t n = get_doubles_n(objs, views, 4);
+    if (n < 0) return NULL;
+
+    PyObject* a = PyBytes_FromStringAndSize(NULL, n * sizeof(double));
+    PyObject* b = PyBytes_FromStringAndSize(NULL, n * sizeof(double));
+    if (a != NULL && b != NULL) {
+        translate_gps_batch(
+            (const double*)views[0].buf, (const double*)views[1].buf,
+            (const double*)views[2].buf, (const double*)views[3].buf, n,
+            DOUBLES(a), DOUBLES(b));
+    }
+    release_doubles(views, 4);
+    if (a == NULL || b == NULL) {
+        Py_XDECREF(a);
+        Py_XDECREF(b);
+        return NULL;
+    }
+    return doubles_pair(a, b, n);
+}
+
+static PyObject* wayArrays(PyObject* self, PyObject* args) {
+    PyObject* objs[3]; /* lat (deg), lon (deg), heading (rad) */
+    double d;          /* distance of the first and last waypoint (m) */
+    if (!PyArg_ParseTuple(args, "OOOd", &objs[0], &objs[1], &objs[2], &d))
+        return NULL;
+    if (d == 0) {
+        PyErr_SetString(PyExc_ValueError, "d must be different from 0");
+        return NULL;
+    }
+    Py_buffer views[3];
+    Py_ssize_t n = get_doubles_n(objs, views, 3);
+    if (n < 0) return NULL;
+
+    PyObject* buffer = PyBytes_FromStringAndSize(NULL, n * 6 * sizeof(double));
+    if (buffer != NULL) {
+        way_array_batch((const double*)views[0].buf,
+                        (const double*)views[1].buf,
+                        (const double*)views[2].buf, n, d, DOUBLES(buffer));
+    }
+    release_doubles(views, 3);
+
+    /* shape = (n, 3, 2): {first, drop, last} x {lat, lon} */
+    return doubles_view(buffer, Py_BuildValue("(nii)", n, 3, 2));
+}
+
+/* iterator over the states of a single trajectory, see Simulation::stream */
+typedef struct {
+    PyObject_HEAD
+    Generator<State<3>>* gen;
+} TrajectoryIterator;
+
+static void TrajectoryIterator_dealloc(TrajectoryIterator* self) {
+    PyTypeObject* type = Py_TYPE(self); /* heap type, owned by instances */
+    delete self->gen; /* stops the integration if it is not over */
+    type->tp_free((PyObject*)self);
+    Py_DECREF(type);
+}
+
+static PyObject* TrajectoryIterator_next(TrajectoryIterator* self) {
+    if (self->gen == NULL) return NULL;
+    try {
+        if (!self->gen->next()) return NULL;
+    } catch (const std::exception& e) {
+        PyErr_SetString(PyExc_RuntimeError, e.what());
+        return NULL;
+    }
+    const State<3>& S = self->gen->value();
+    return Py_BuildValue("(ddddddd)", S.X()[0], S.X()[1], -S.X()[2],
+                         S.X_dot()[0], S.X_dot()[1], -S.X_dot()[2], S.get_t());
+}
+
+static PyType_Slot TrajectoryIterator_slots[] = {
+    {Py_tp_dealloc, (void*)TrajectoryIterator_dealloc},
+    {Py_tp_doc, (void*)"Stati di una traiettoria NED."},
+    {Py_tp_iter, (void*)PyObject_SelfIter},
+    {Py_tp_iternext, (void*)TrajectoryIterator_next},
+    {0, NULL}};
+
+static PyType_Spec TrajectoryIterator_spec = {
+    "libsft_fall_model.TrajectoryIterator", sizeof(TrajectoryIterator), 0,
+    Py_TPFLAGS_DEFAULT, TrajectoryIterator_slots};
+
+// Created by PyInit from TrajectoryIterator_spec
+static PyTypeObject* TrajectoryIteratorType = NULL;
+
+static PyObject* iterTrajectory(PyObject* self, PyObject* args) {
+    /* params of run */
+    const char* wind;       /* describe the wind:   '{degree}{nodes}KT'  */
+    double vel_head,        /* velocity of UAV:   radians,               */
+        vel_speed,          /*                    magnitude,             */
+        vel_down;           /*                    v_down                 */
+    double h,               /* altitude of UAV (in m)                    */
+        m;                  /* Mass of payload                           */
+    float CdS;              /* CdS coefficient of parachutes  */
+    int time,               /* Time of the simulation (in s)  */
+        step;               /* Step of the simulation (in ms) */
+    const char* integrator; /* integrator */
+    double tail_tol = 0;    /* terminal tail tolerance (m/s2), optional */
+
+    if (!PyArg_ParseTuple(args, "s(ddd)ddfiis|d", &wind, &vel_head, &vel_speed,
+                          &vel_down, &h, &m, &CdS, &time, &step, &integrator,
+                          &tail_tol)) {
+        return NULL;
+    }
+
+    int angle_grad = 0;
+    int speed_knots = 0;
+    sscanf(wind, "%3d%2dKT", &angle_grad, &speed_knots);
+    double wind_head = angle_grad * M_PI / 180.0;
+    double wind_speed = speed_knots * KT2M;
+
+    TrajectoryIterator* it =
+        PyObject_New(TrajectoryIterator, TrajectoryIteratorType);
+    if (it == NULL) return NULL;
+    it->gen = NULL;
+    try {
+        ODESettings cfg = sim_settings(step / 1000., time, integrator);
+        if (tail_tol > 0) cfg.tail_tol = tail_tol;
+        Simulation s(cfg);
+        FixedBallisticModel bm(
+            m, CdS,
+            VReal3{wind_speed * cos(wind_head), wind_speed * sin(wind_head), 0},
+            1);
+        State<3> S0 = {0,
+                       0,
+                       -h,
+                       vel_speed * cos(vel_head),
+                       vel_speed * sin(vel_head),
+                       vel_down};
+        it->gen = new Generator<State<3>>(s.stream(bm, S0));
+    } catch (std::exception& e) {
+        Py_DECREF(it);
+        PyErr_SetString(PyExc_ValueError, e.what());
+        return NULL;
+    }
+    return (PyObject*)it;
+}
+
+/* reader of the drop solution published in shared memory, see
+ * SharedSolution.h */
+typedef struct {
+    PyObject_HEAD
+    SolutionReader* reader;
+} SolutionReaderObject;
+
+static void SolutionReader_dealloc(SolutionReaderObject* self) {
+    PyTypeObject* type = Py_TYPE(self); /* heap type, owned by instances */
+    delete self->reader;
+    type->tp_free((PyObject*)self);
+    Py_DECREF(type);
+}
+
+/* (stamp, (lat, lon), ((lat, lon) x 3), time_to_release, spread), None if
+ * nothing was published yet */
+static PyObject* solution_tuple(const DropSolution& sol) {
+    const double* w = sol.waypoints;
+    return Py_BuildValue("(d(dd)((dd)(dd)(dd))dN)", sol.stamp, sol.drop_lat,
+                         sol.drop_lon, w[0], w[1], w[2], w[3], w[4], w[5],
+                         sol.time_to_release, spread_tuple(sol.spread));
+}
+
+static PyObject* SolutionReader_read(SolutionReaderObject* self,
+                                     PyObject* Py_UNUSED(args)) {
+    DropSolution sol;
+    if (!self->reader->read(sol)) Py_RETURN_NONE;
+    return solution_tuple(sol);
+}
+
+static PyObject* SolutionReader_version(SolutionReaderObject* self,
+                                        PyObject* Py_UNUSED(args)) {
+    return PyLong_FromUnsignedLongLong(self->reader->version());
+}
+
+static PyMethodDef SolutionReader_methods[] = {
+    {"read", (PyCFunction)SolutionReader_read, METH_NOARGS, "Ultima soluzione pubblicata, None se non ce ne sono."},
+    {"version", (PyCFunction)SolutionReader_version, METH_NOARGS, "Numero di soluzioni pubblicate finora."},
+    {NULL, NULL, 0, NULL}};
+
+static PyType_Slot SolutionReader_slots[] = {
+    {Py_tp_dealloc, (void*)SolutionReader_dealloc},
+    {Py_tp_doc, (void*)"Soluzione di drop in memoria condivisa."},
+    {Py_tp_methods, (void*)SolutionReader_methods},
+    {0, NULL}};
+
+static PyType_Spec SolutionReader_spec = {
+    "libsft_fall_model.SolutionReader", sizeof(SolutionReaderObject), 0,
+    Py_TPFLAGS_DEFAULT, SolutionReader_slots};
+
+// Created by PyInit from SolutionReader_spec
+static PyTypeObject* SolutionReaderType = NULL;
+
+static PyObject* openSolution(PyObject* self, PyObject* args) {
+    const char* name = "/sft_drop"; /* shared memory name, optional */
+    if (!PyArg_ParseTuple(args, "|s", &name)) return NULL;
+
+    SolutionReaderObject* r =
+        PyObject_New(SolutionReaderObject, SolutionReaderType);
+    if (r == NULL) return NULL;
+    r->reader = NULL;
+    try {
+        r->reader = new SolutionReader(name);
+    } catch (std::exception& e) {
+        Py_DECREF(r);
+        PyErr_SetString(PyExc_OSError, e.what());
+        return NULL;
+    }
+    return (PyObject*)r;
+}
+
+static PyObject* startPredictor(PyObject* self, PyObject* args) {
+    PredictorConfig cfg;
+    double step;            /* Step of the simulation (in ms) */
+    const char* integrator; /* integrator */
+    const char* shm_name = ""; /* shared memory to publish to, optional */
+    PyObject* sigma = NULL; /* 1-sigma of (wind N, wind E, CdS, mass,
+                               vel N, vel E, vel D), optional */
+
+    if (!PyArg_ParseTuple(args, "(dd)ddddds|sdO", &cfg.target.lat,
+                          &cfg.target.lon, &cfg.mass, &cfg.cds, &cfg.rate_hz,
+                          &cfg.T, &step, &integrator, &shm_name, &cfg.way_d,
+                          &sigma)) {
+        return NULL;
+    }
+    cfg.dt = step / 1000.;
+    cfg.method = integrator;
+    cfg.shm_name = shm_name;
+    if (sigma != NULL && sigma != Py_None &&
+        !PyArg_ParseTuple(sigma, "ddddddd", &cfg.sigma[0], &cfg.sigma[1],
+                          &cfg.sigma[2], &cfg.sigma[3], &cfg.sigma[4],
+                          &cfg.sigma[5], &cfg.sigma[6])) {
+        return NULL;
+    }
+
+    predictor.reset(); /* one predictor at a time */
+    try {
+        predictor = std::make_unique<Predictor>(cfg);
+    } catch (std::exception& e) {
+        PyErr_SetString(PyExc_ValueError, e.what());
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject* stopPredictor(PyObject* self, PyObject* args) {
+    predictor.reset();
+    Py_RETURN_NONE;
+}
+
+static PyObject* pushTelemetry(PyObject* self, PyObject* args) {
+    Telemetry t;
+    PyObject* wind;         /* (N, E) m/s, None = from the wind estimator */
+    if (!PyArg_ParseTuple(args, "d(dd)d(ddd)O", &t.stamp, &t.lat, &t.lon,
+                          &t.h, &t.vel_n, &t.vel_e, &t.vel_d, &wind)) {
+        return NULL;
+    }
+    if (wind == Py_None) {
+        if (!wind_estimator) {
+            PyErr_SetString(PyExc_RuntimeError, "wind estimator not started");
+            return NULL;
+        }
+        VReal3 w = wind_estimator->wind(t.h);
+        t.wind_n = w[0];
+        t.wind_e = w[1];
+    } else if (!PyArg_ParseTuple(wind, "dd", &t.wind_n, &t.wind_e)) {
+        return NULL;
+    }
+    if (!predictor) {
+        PyErr_SetString(PyExc_RuntimeError, "predictor not started");
+        return NULL;
+    }
+    return PyBool_FromLong(predictor->push(t));
+}
+
+static PyObject* latestSolution(PyObject* self, PyObject* args) {
+    DropSolution sol;
+    if (!predictor || !predictor->latest(sol)) Py_RETURN_NONE;
+    return solution_tuple(sol);
+}
+
+static PyObject* predictorStats(PyObject* self, PyObject* args) {
+    PredictorStats st;
+    if (predictor) st = predictor->stats();
+    return Py_BuildValue("(KKKKKddd)", (unsigned long long)st.solutions,
+                         (unsigned long long)st.reused,
+                         (unsigned long long)st.missed,
+                         (unsigned long long)st.dropped,
+                         (unsigned long long)st.skipped, st.p50_us, st.p99_us,
+                         st.max_us);
+}
+
+static PyObject* startWindEstimator(PyObject* self, PyObject* args) {
+    WindEstimatorConfig cfg;
+    int shear = 0;          /* estimate the shear with altitude, optional */
+    /* 1-sigma of ground minus air velocity (m/s) and of the wind random
+       walk (m/s/sqrt(s)), optional */
+    if (!PyArg_ParseTuple(args, "|pdd", &shear, &cfg.r_vel, &cfg.q_wind)) {
+        return NULL;
+    }
+    if (cfg.r_vel <= 0 || cfg.q_wind < 0) {
+        PyErr_SetString(PyExc_ValueError, "r_vel must be > 0, q_wind >= 0");
+        return NULL;
+    }
+    cfg.shear = shear;
+    wind_estimator = std::make_unique<WindEstimator>(cfg);
+    Py_RETURN_NONE;
+}
+
+static PyObject* pushAirData(PyObject* self, PyObject* args) {
+    AirData a;
+    if (!PyArg_ParseTuple(args, "dddd(dd)", &a.stamp, &a.h, &a.airspeed,
+                          &a.heading, &a.vel_n, &a.vel_e)) {
+        return NULL;
+    }
+    if (!wind_estimator) {
+        PyErr_SetString(PyExc_RuntimeError, "wind estimator not started");
+        return NULL;
+    }
+    return PyBool_FromLong(wind_estimator->update(a));
+}
+
+static PyObject* windEstimate(PyObject* self, PyObject* args) {
+    double h = NAN;         /* altitude (m), optional: the reference one */
+    if (!PyArg_ParseTuple(args, "|d", &h)) return NULL;
+    if (!wind_estimator || wind_estimator->samples() == 0) Py_RETURN_NONE;
+    if (std::isnan(h)) h = wind_estimator->reference_altitude();
+    VReal3 w = wind_estimator->wind(h);
+    auto var = wind_estimator->variance(h);
+    auto sh = wind_estimator->shear();
+    /* ((N, E), (var N, var E), (shear N, shear E), samples, rejected) */
+    return Py_BuildValue("((dd)(dd)(dd)KK)", w[0], w[1], var[0], var[1],
+                         sh[0], sh[1],
+                         (unsigned long long)wind_estimator->samples(),
+                         (unsigned long long)wind_estimator->rejected());
+}
+
+static PyObject* executorStats(PyObject* self, PyObject* args) {
+    /* (jobs, chunks, p50 us, p99 us) of the LIVE, NORMAL and BULK classes */
+    PyObject* result = PyTuple_New(N_PRIORITIES);
+    if (result == NULL) return NULL;
+    for (size_t c = 0; c < N_PRIORITIES; c++) {
+        ExecutorStats st = Executor::shared().stats(Priority(c));
+        PyTuple_SET_ITEM(result, c,
+                         Py_BuildValue("(KKdd)", (unsigned long long)st.jobs,
+                                       (unsigned long long)st.chunks,
+                                       st.p50_us, st.p99_us));
+    }
+    return result;
+}
+
+static PyObject* setReservedWorkers(PyObject* self, PyObject* args) {
+    Py_ssize_t n; /* workers kept for live queries */
+    if (!PyArg_ParseTuple(args, "n", &n)) return NULL;
+    if (n < 0) {
+        PyErr_SetString(PyExc_ValueError, "n must be >= 0");
+        return NULL;
+    }
+    Executor::shared().set_reserved(n);
+    Py_RETURN_NONE;
+}
+
+/* traceStart and traceStop go between the simulations: the per thread
+   buffers are cleared and read without lock, see Tracer */
+static PyObject* traceStart(PyObject* self, PyObject* args) {
+#ifdef SFT_TRACE
+    Tracer::get().start();
+    Py_RETURN_NONE;
+#else
+    PyErr_SetString(PyExc_RuntimeError,
+                    "tracing compiled out, build with -DSFT_TRACE=ON");
+    return NULL;
+#endif
+}
+
+static PyObject* traceStop(PyObject* self, PyObject* args) {
+    const char* path; /* Chrome trace JSON, for Perfetto */
+    if (!PyArg_ParseTuple(args, "s", &path)) return NULL;
+#ifdef SFT_TRACE
+    Tracer::get().stop();
+    int64_t n;
+    Py_BEGIN_ALLOW_THREADS
+    n = Tracer::get().write_json(path);
+    Py_END_ALLOW_THREADS
+    if (n < 0) {
+        PyErr_Format(PyExc_OSError, "Cannot write trace %s", path);
+        return NULL;
+    }
+    /* number of events written */
+    return PyLong_FromLongLong(n);
+#else
+    PyErr_SetString(PyExc_RuntimeError,
+                    "tracing compiled out, build with -DSFT_TRACE=ON");
+    return NULL;
+#endif
+}
+
 static PyMethodDef module_methods[] = {
     {"dropPoints", dropPoints, METH_VARARGS, "Punti di drop in coordinate GPS."},
     {"trajectories", trajectories, METH_VARARGS, "Traiettorie in coordinate NED."},
+    {"iterTrajectory", iterTrajectory, METH_VARARGS, "Iteratore sugli stati di una traiettoria NED, calcolati al volo."},
+    {"openSolution", openSolution, METH_VARARGS, "Lettore della soluzione di drop pubblicata in memoria condivisa."},
+    {"startPredictor", startPredictor, METH_VARARGS, "Avvia il predittore in tempo reale del punto di drop."},
+    {"stopPredictor", stopPredictor, METH_NOARGS, "Ferma il predittore."},
+    {"pushTelemetry", pushTelemetry, METH_VARARGS, "Accoda un campione di telemetria al predittore."},
+    {"latestSolution", latestSolution, METH_NOARGS, "Ultima soluzione del predittore, None se non ce ne sono."},
+    {"predictorStats", predictorStats, METH_NOARGS, "Soluzioni, riusi, scadenze mancate, campioni persi e latenze del predittore."},
+    {"trajectoryAt", trajectoryAt, METH_VARARGS, "Stati NED interpolati a tempi o quote dati."},
+    {"dropWindow", dropWindow, METH_VARARGS, "Finestra di rilascio lungo una rotta e waypoint per l'autopilota."},
+    {"rankHeadings", rankHeadings, METH_VARARGS, "Prue di avvicinamento ordinate per dispersione dell'atterraggio."},
+    {"dispersion", dispersion, METH_VARARGS, "Media e covarianza dell'atterraggio con unscented transform o Monte Carlo."},
+    {"anytimeDrop", anytimeDrop, METH_VARARGS, "Atterraggio entro un tempo massimo, raffinato finche' il tempo lo consente."},
+    {"qmcMean", qmcMean, METH_VARARGS, "Atterraggio medio con campionamento quasi Monte Carlo e riduzione della varianza."},
+    {"qmcConvergence", qmcConvergence, METH_VARARGS, "Curve di convergenza dei campionamenti rispetto al Monte Carlo."},
+    {"sobolIndices", sobolIndices, METH_VARARGS, "Indici di Sobol del punto di atterraggio (primo ordine e totali)."},
+    {"windInversion", windInversion, METH_VARARGS, "Vento effettivo che spiega l'atterraggio di ogni lancio registrato."},
+    {"autotuneIntegrator", autotuneIntegrator, METH_VARARGS, "Integratore e passo piu' economici entro un errore di atterraggio, salvati come profilo."},
+    {"loadProfile", loadProfile, METH_VARARGS, "Carica un profilo: integrator='profile' ne usa metodo, passo e coda terminale."},
+    {"setDropCache", setDropCache, METH_VARARGS, "Attiva (capacita' > 0) o disattiva la cache dei punti di drop."},
+    {"dropCacheStats", dropCacheStats, METH_NOARGS, "Hit, miss, elementi e capacita' della cache dei punti di drop."},
+    {"clearDropCache", clearDropCache, METH_NOARGS, "Svuota la cache dei punti di drop e azzera i contatori."},
+    {"startWindEstimator", startWindEstimator, METH_VARARGS, "Avvia (o riavvia) la stima del vento dai dati aria."},
+    {"pushAirData", pushAirData, METH_VARARGS, "Aggiorna la stima del vento con un campione di velocita' aria e suolo."},
+    {"windEstimate", windEstimate, METH_VARARGS, "Vento stimato a una quota, varianze, gradiente e campioni, None se non ce ne sono."},
+    {"executorStats", executorStats, METH_NOARGS, "Job, chunk e latenze di coda (p50, p99) per classe di priorita'."},
+    {"setReservedWorkers", setReservedWorkers, METH_VARARGS, "Numero di thread riservati alle query live."},
+    {"traceStart", traceStart, METH_NOARGS, "Avvia la registrazione della timeline delle simulazioni parallele."},
+    {"traceStop", traceStop, METH_VARARGS, "Ferma la registrazione e salva la timeline in formato Chrome trace (Perfetto)."},
+    {"toGPS", toGPS, METH_VARARGS, "Coordinate GPS di punti (nord, est) attorno a un target."},
+    {"toENU", toENU, METH_VARARGS, "Coordinate (nord, est) di punti GPS attorno a un target."},
+    {"dropGPS", dropGPS, METH_VARARGS, "Punti di drop in coordinate GPS da atterraggi NED, stesso target."},
+    {"translateGPS", translateGPS, METH_VARARGS, "Traslazione di punti GPS lungo cerchi massimi."},
+    {"wayArrays", wayArrays, METH_VARARGS, "Waypoint (primo, drop, ultimo) di piu' punti di drop."},
+    {"dropSweep", dropSweep, METH_VARARGS, "Atterraggi NED su una griglia di condizioni di lancio."},
     {NULL, NULL, 0, NULL}};
 
 static struct PyModuleDef libsft_fall_modelModule = {
@@ -482,6 +2306,13 @@ static struct PyModuleDef libsft_fall_modelModule = {
     NULL};
 
 PyMODINIT_FUNC PyInit_libsft_fall_model(void) {
+    TrajectoryIteratorType =
+        (PyTypeObject*)PyType_FromSpec(&TrajectoryIterator_spec);
+    if (TrajectoryIteratorType == NULL) return NULL;
+
+    SolutionReaderType = (PyTypeObject*)PyType_FromSpec(&SolutionReader_spec);
+    if (SolutionReaderType == NULL) return NULL;
+
     return PyModule_Create(&libsft_fall_modelModule);
 }
 
@@ -0,0 +1,152 @@
+/**
+ * Load generator of the drop server, see Protocol.h
+ *
+ * Each client thread has its own connection and sends its requests one
+ * after the other, so the clients are the concurrent requests the server
+ * can batch. Latency is measured from send to full reply.
+ *
+ * usage: sft_loadgen [socket] [clients] [requests] [launches] [type]
+ *        type is drop (default), trajectory or stats
+ */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../include/Protocol.h"
+
+static double percentile(std::vector<double> v, double p) {
+    if (v.empty()) return 0;
+    size_t k = std::min(v.size() - 1, size_t(p * double(v.size())));
+    std::nth_element(v.begin(), v.begin() + k, v.end());
+    return v[k];
+}
+
+// Sends a request and reads the reply, false on a broken connection
+static bool query(int fd, const proto::RequestHeader& head,
+                  const std::vector<proto::Launch>& launches,
+                  proto::ReplyHeader& reply, std::vector<char>& body) {
+    if (!proto::write_full(fd, &head, sizeof(head)) ||
+        !proto::write_full(fd, launches.data(),
+                           launches.size() * sizeof(proto::Launch)) ||
+        !proto::read_full(fd, &reply, sizeof(reply))) {
+        return false;
+    }
+    body.clear();
+    if (reply.status != proto::OK) return true;
+    if (head.type == proto::DROP) {
+        body.resize(reply.count * 2 * sizeof(double));
+        return proto::read_full(fd, body.data(), body.size());
+    }
+    if (head.type == proto::STATS) {
+        body.resize(sizeof(proto::ServerStats));
+        return proto::read_full(fd, body.data(), body.size());
+    }
+    for (uint32_t i = 0; i < reply.count; i++) {
+        uint32_t len;
+        if (!proto::read_full(fd, &len, sizeof(len))) return false;
+        std::vector<char> states(size_t(len) * 7 * sizeof(double));
+        if (!proto::read_full(fd, states.data(), states.size())) return false;
+        body.insert(body.end(), states.begin(), states.end());
+    }
+    return true;
+}
+
+static void print_stats(const std::string& path) {
+    int fd = proto::connect_socket(path);
+    proto::RequestHeader head;
+    head.type = proto::STATS;
+    proto::ReplyHeader reply;
+    std::vector<char> body;
+    if (fd < 0 || !query(fd, head, {}, reply, body) || body.empty()) {
+        std::cerr << "Cannot read the server stats\n";
+    } else {
+        const auto* st = reinterpret_cast<const proto::ServerStats*>(body.data());
+        std::cout << "server: requests " << st->requests << "  launches "
+                  << st->launches << "  batches " << st->batches << "  p50 "
+                  << st->p50_us << " us  p99 " << st->p99_us << " us  "
+                  << st->throughput << " req/s\n";
+    }
+    if (fd >= 0) ::close(fd);
+}
+
+int main(int argc, char** argv) {
+    std::string path = argc > 1 ? argv[1] : "/tmp/sft_fall_model.sock";
+    size_t n_clients = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 8;
+    size_t n_requests = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 1000;
+    size_t n_launches = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : 1;
+    std::string type = argc > 5 ? argv[5] : "drop";
+
+    if (type == "stats") {
+        print_stats(path);
+        return 0;
+    }
+
+    std::vector<std::vector<double>> latency(n_clients);
+    std::vector<size_t> errors(n_clients, 0);
+    std::vector<std::thread> clients;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t c = 0; c < n_clients; c++) {
+        clients.emplace_back([&, c]() {
+            int fd = proto::connect_socket(path);
+            if (fd < 0) {
+                errors[c] = n_requests;
+                return;
+            }
+            // Conditions around those of test2.csv
+            std::mt19937_64 gen(c);
+            std::uniform_real_distribution<double> u(0, 1);
+            proto::RequestHeader head;
+            head.type = type == "trajectory" ? proto::TRAJECTORY : proto::DROP;
+            head.count = n_launches;
+            std::vector<proto::Launch> launches(n_launches);
+            proto::ReplyHeader reply;
+            std::vector<char> body;
+            latency[c].reserve(n_requests);
+            for (size_t r = 0; r < n_requests; r++) {
+                for (auto& l : launches) {
+                    l = {2 * M_PI * u(gen), 5 * u(gen), 2 * M_PI * u(gen),
+                         15 + 10 * u(gen),  0,           30 + 20 * u(gen),
+                         1 + 0.5 * u(gen),  0.3,         45.0 + 0.01 * u(gen),
+                         9.0 + 0.01 * u(gen)};
+                }
+                head.id = r;
+                auto t0 = std::chrono::steady_clock::now();
+                if (!query(fd, head, launches, reply, body)) {
+                    errors[c] += n_requests - r;
+                    break;
+                }
+                latency[c].push_back(std::chrono::duration<double, std::micro>(
+                                         std::chrono::steady_clock::now() - t0)
+                                         .count());
+                if (reply.status != proto::OK || reply.id != r) errors[c]++;
+            }
+            ::close(fd);
+        });
+    }
+    for (auto& t : clients) t.join();
+    double elapsed = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+
+    std::vector<double> all;
+    size_t n_errors = 0;
+    for (size_t c = 0; c < n_clients; c++) {
+        all.insert(all.end(), latency[c].begin(), latency[c].end());
+        n_errors += errors[c];
+    }
+    std::cout << "client: " << all.size() << " requests of " << n_launches
+              << " launches, " << n_clients << " clients, " << n_errors
+              << " errors\n"
+              << "client: p50 " << percentile(all, 0.50) << " us  p99 "
+              << percentile(all, 0.99) << " us  "
+              << double(all.size()) / elapsed << " req/s  "
+              << double(all.size() * n_launches) / elapsed << " launches/s\n";
+    print_stats(path);
+    return n_errors ? 1 : 0;
+}
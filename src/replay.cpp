@@ -0,0 +1,95 @@
+/**
+ * Flight log replay, accuracy and speed of the model against real drops
+ *
+ * Every flight of the log is replayed with each method/dt pair of the
+ * matrix, the flights of a setting in parallel and the settings one after
+ * the other so that their timings do not interfere. The landing errors
+ * are against the logged landings; ref is the RMS distance from rk4 at a
+ * tenth of the smallest step, the integration error alone.
+ *
+ * usage: sft_replay [log] [CdS] [methods] [dts_ms] [T] [repeat] [max_p95]
+ *        methods and dts_ms are comma separated lists, e.g. rk4,euler,
+ *        analytic and 1,2,5,10; with max_p95 > 0 the exit status is 1 if
+ *        a setting has a 95th percentile error above it (m)
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../include/pch.h"
+#include "../include/Replay.h"
+
+static std::vector<std::string> split(const std::string& s) {
+    std::vector<std::string> out;
+    size_t pos = 0;
+    while (pos <= s.size()) {
+        size_t end = s.find(',', pos);
+        if (end == std::string::npos) end = s.size();
+        if (end > pos) out.push_back(s.substr(pos, end - pos));
+        pos = end + 1;
+    }
+    return out;
+}
+
+int main(int argc, char** argv) {
+    std::string path = argc > 1 ? argv[1] : "test2.csv";
+    double cds = argc > 2 ? std::atof(argv[2]) : 0.136;
+    auto methods = split(argc > 3 ? argv[3] : "rk4,rk45,euler,analytic");
+    std::vector<double> dts;
+    for (auto& s : split(argc > 4 ? argv[4] : "1,2,5,10")) {
+        dts.push_back(std::atof(s.c_str()) / 1000.);
+    }
+    double T = argc > 5 ? std::atof(argv[5]) : 20;
+    size_t repeat = argc > 6 ? std::strtoul(argv[6], nullptr, 10) : 3;
+    double max_p95 = argc > 7 ? std::atof(argv[7]) : 0;
+
+    std::vector<FlightRecord> log;
+    try {
+        log = read_flight_log(path);
+    } catch (std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 2;
+    }
+    if (log.empty() || dts.empty()) {
+        std::cerr << "Nothing to replay\n";
+        return 2;
+    }
+
+    double dt_min = dts[0];
+    for (double dt : dts) dt_min = std::min(dt_min, dt);
+    double ref_us;
+    auto ref = replay_landings(log, cds, "rk4", dt_min / 10, T, 1, ref_us);
+
+    std::printf("%zu flights from %s, CdS %.4f, T %.0f s, %zu threads\n",
+                log.size(), path.c_str(), cds, T,
+                Executor::shared().size());
+    std::printf("%-9s %7s %6s %8s %8s %8s %8s %8s %9s %10s %11s\n", "method",
+                "dt_ms", "landed", "mean_m", "rms_m", "p50_m", "p95_m",
+                "max_m", "ref_m", "wall_us", "runs/s");
+    int status = 0;
+    for (auto& method : methods) {
+        for (size_t k = 0; k < dts.size(); k++) {
+            if (method == "analytic" && k > 0) break;  // No step
+            ReplayStats st;
+            try {
+                st = replay(log, cds, method, dts[k], T, repeat, ref);
+            } catch (std::exception& e) {
+                std::cerr << method << ": " << e.what() << "\n";
+                status = 2;
+                break;
+            }
+            std::printf(
+                "%-9s %7.2f %3zu/%-3zu %8.3f %8.3f %8.3f %8.3f %8.3f %9.4f "
+                "%10.0f %11.0f\n",
+                st.method.c_str(), st.dt * 1000, st.landed, st.flights,
+                st.mean_err, st.rms_err, st.p50_err, st.p95_err, st.max_err,
+                st.ref_rms, st.wall_us, st.runs_per_s);
+            if (max_p95 > 0 && (st.p95_err > max_p95 || st.landed < st.flights)) {
+                status = std::max(status, 1);
+            }
+        }
+    }
+    return status;
+}
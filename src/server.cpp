@@ -0,0 +1,44 @@
+/**
+ * Drop point server, see DropServer.h and Protocol.h
+ *
+ * usage: sft_server [socket] [max_batch] [max_wait_us] [report_s]
+ */
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+
+#include "../include/pch.h"
+#include "../include/DropServer.h"
+
+static DropServer* server = nullptr;
+
+static void on_signal(int) {
+    if (server) server->request_stop();
+}
+
+int main(int argc, char** argv) {
+    DropServer::Options opt;
+    opt.report_s = 5;
+    if (argc > 1) opt.path = argv[1];
+    if (argc > 2) opt.max_batch = std::strtoul(argv[2], nullptr, 10);
+    if (argc > 3) {
+        opt.max_wait = std::chrono::microseconds(std::atol(argv[3]));
+    }
+    if (argc > 4) opt.report_s = std::atof(argv[4]);
+
+    DropServer s(opt);
+    server = &s;
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+
+    std::cerr << "Serving on " << opt.path << ", batches of " << opt.max_batch
+              << " launches or " << opt.max_wait.count() << " us, "
+              << N_THREADS << " threads\n";
+    try {
+        s.run();
+    } catch (std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
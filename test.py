@@ -1,6 +1,6 @@
 #!/usr/bin/python3
 
-from libsft_fall_model import dropPoints, trajectories
+from libsft_fall_model import dropPoints, trajectories, sobolIndices
 import numpy as np
 from scipy.optimize import minimize
 import pandas as pd
@@ -122,4 +122,19 @@ plt.show()
 
 # calcolo bias
 bias = np.linalg.norm(np.cumsum(relative_error, axis=1)/len(relative_error))
-print(bias)
\ No newline at end of file
+print(bias)
+# indici di Sobol del punto di landing sulle condizioni del test
+# incertezze 1-sigma: vento N, vento E, CdS, massa, vel N, vel E, vel D
+sd = (1.0, 1.0, 0.1*CdS_optimized, 0.02, 0.5, 0.5, 0.3)
+names = ['vento N', 'vento E', 'CdS', 'massa', 'vel N', 'vel E', 'vel D']
+indices = sobolIndices(empirical_data['wind'].tolist(),
+                       list(zip(empirical_data['Head'], empirical_data['Vel'], empirical_data['V_down'])),
+                       list(zip(empirical_data['Lat_land'], empirical_data['Long_land'])),
+                       empirical_data['H'].tolist(), empirical_data['mass'].tolist(),
+                       CdS_optimized, sd, 1024, 10, 2, 'rk4')
+S_N = np.mean([launch[0] for launch in indices], axis=0)
+ST_N = np.mean([launch[1] for launch in indices], axis=0)
+S_E = np.mean([launch[2] for launch in indices], axis=0)
+ST_E = np.mean([launch[3] for launch in indices], axis=0)
+for k in range(len(names)):
+    print(f"{names[k]}: S_N {S_N[k]:.3f} ST_N {ST_N[k]:.3f} S_E {S_E[k]:.3f} ST_E {ST_E[k]:.3f}")